@@ -1,3 +1,6 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
 #include <assert.h>
 #include <memory.h>
 #include <stdbool.h>
@@ -8,7 +11,21 @@
 
 #define DEFAULT_ALIGNMENT 8
 #define StackAlloc(arena, type, n) \
-    (type*)StackAllocAlign(arena, sizeof(type) * n, DEFAULT_ALIGNMENT)
+    (type*)Stack_AllocAlign(arena, sizeof(type) * (n), DEFAULT_ALIGNMENT)
+
+/*
+ * How a new block is initialised.  ALLOC_NO_ZERO skips the memset for
+ * buffers that are overwritten straight away; ALLOC_POISON additionally
+ * fills them with ALLOC_POISON_BYTE in debug builds so reads of
+ * uninitialised memory stand out.  Freed memory is never cleared.
+ */
+typedef enum {
+    ALLOC_NO_ZERO = 0,
+    ALLOC_ZERO = 1 << 0,
+    ALLOC_POISON = 1 << 1,
+} ALLOC_FLAGS;
+
+#define ALLOC_POISON_BYTE 0xCD
 
 bool is_power_of_two(uintptr_t x);
 
@@ -28,5 +45,209 @@ typedef struct Stack {
 } Stack;
 
 void Stack_Init(Stack* arena, void* buf, size_t capacity);
+// Zeroed; same as Stack_AllocAlignFlags(..., ALLOC_ZERO)
 void* Stack_AllocAlign(Stack* arena, size_t size, size_t alignment);
+void* Stack_AllocAlignFlags(
+    Stack* arena, size_t size, size_t alignment, ALLOC_FLAGS flags
+);
 void Stack_Pop(Stack* arena);
+size_t Stack_Save(const Stack* arena);
+// Frees everything allocated after `marker` in O(1), without clearing.
+void Stack_Restore(Stack* arena, size_t marker);
+
+/*
+ * Growable arena built from a chain of Stack blocks.  When the current block
+ * is full a new one is malloc'd, each twice the size of the last, so the
+ * arena never needs to be sized up front.  Allocations never move.
+ */
+#define ARENA_MIN_BLOCK_SIZE 4096
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* prev;
+    Stack stack;
+} ArenaBlock;
+
+typedef struct Arena {
+    ArenaBlock* current;
+    // One emptied block is kept around so popping across a block boundary
+    // and pushing again does not hit malloc every time.
+    ArenaBlock* spare;
+    size_t next_block_size;
+} Arena;
+
+typedef struct ArenaMarker {
+    ArenaBlock* block;
+    size_t offset;
+} ArenaMarker;
+
+#define ArenaAlloc(arena, type, n) \
+    (type*)Arena_AllocAlign(arena, sizeof(type) * n, DEFAULT_ALIGNMENT)
+
+void Arena_Init(Arena* arena, size_t initial_block_size);
+void* Arena_AllocAlign(Arena* arena, size_t size, size_t alignment);
+void* Arena_AllocAlignFlags(
+    Arena* arena, size_t size, size_t alignment, ALLOC_FLAGS flags
+);
+// Pops the most recent allocation, like Stack_Pop, releasing the block once
+// it is empty.
+void Arena_Pop(Arena* arena);
+ArenaMarker Arena_Save(const Arena* arena);
+// Frees everything allocated after `marker`, including whole blocks.
+void Arena_Restore(Arena* arena, ArenaMarker marker);
+void Arena_Free(Arena* arena);
+
+/*
+ * Per-thread scratch Arenas for temporaries, so worker threads never share
+ * an allocator or go through malloc:
+ *
+ *     Scratch scratch = Scratch_Begin(&out_arena, 1);
+ *     f32* tmp = ArenaAlloc(scratch.arena, f32, n);
+ *     ...
+ *     Scratch_End(scratch);
+ *
+ * A function that allocates its result in an arena it was handed passes it
+ * as a conflict, so its temporaries come from a different scratch arena and
+ * Scratch_End cannot free the caller's data.  Scopes nest.
+ */
+#define SCRATCH_ARENA_COUNT 2
+#define SCRATCH_BLOCK_SIZE (64 << 10)
+
+typedef struct Scratch {
+    Arena* arena;
+    ArenaMarker marker;
+} Scratch;
+
+Scratch Scratch_Begin(Arena* const* conflicts, size_t n_conflicts);
+void Scratch_End(Scratch scratch);
+// Frees the calling thread's scratch memory; call before a worker exits.
+void Scratch_ReleaseThread(void);
+
+/*
+ * Bump allocator over one large PROT_NONE reservation.  Pages are committed
+ * as `offset` advances, so the most recent allocation can grow in place
+ * without copying and every pointer stays valid until a restore or reset.
+ */
+#define VIRTUAL_STACK_DEFAULT_RESERVE ((size_t)64 << 30)
+#define VIRTUAL_STACK_COMMIT_SIZE ((size_t)64 << 10)
+
+typedef struct VirtualStack {
+    uint8_t* base;
+    size_t offset;
+    size_t last_offset;
+    size_t committed;
+    size_t reserved;
+} VirtualStack;
+
+bool VirtualStack_Init(VirtualStack* arena, size_t reserve);
+void* VirtualStack_AllocAlign(VirtualStack* arena, size_t size, size_t alignment);
+// Resizes the most recent allocation in place; `ptr` == NULL allocates.
+void* VirtualStack_Grow(
+    VirtualStack* arena, void* ptr, size_t new_size, size_t alignment
+);
+size_t VirtualStack_Save(const VirtualStack* arena);
+// Drops allocations after `marker` but keeps their pages committed.
+void VirtualStack_Restore(VirtualStack* arena, size_t marker);
+// Drops everything and hands the committed pages back to the kernel.
+void VirtualStack_Reset(VirtualStack* arena);
+void VirtualStack_Release(VirtualStack* arena);
+
+/*
+ * Fixed-size slots carved out of a backing Stack, for objects whose
+ * lifetimes are not LIFO.  Free slots are chained through their own first
+ * bytes, so Pool_Alloc and Pool_Free are O(1) with no per-slot overhead
+ * beyond a generation counter.  Slots that were never used are handed out
+ * from `next_unused`, so Pool_Init does not have to touch every slot.
+ */
+typedef struct PoolSlot {
+    struct PoolSlot* next;
+} PoolSlot;
+
+typedef struct Pool {
+    uint8_t* slots;
+    uint32_t* generations;
+    PoolSlot* free_list;
+    size_t slot_size;
+    size_t capacity;
+    size_t next_unused;
+    size_t used;
+    size_t peak;
+} Pool;
+
+// Live slots have odd generations, so a zeroed handle is always invalid.
+typedef struct PoolHandle {
+    uint32_t index;
+    uint32_t generation;
+} PoolHandle;
+
+typedef struct PoolStats {
+    size_t slot_size;
+    size_t capacity;
+    size_t used;
+    size_t peak;
+} PoolStats;
+
+bool Pool_Init(
+    Pool* pool, Stack* backing, size_t slot_size, size_t alignment,
+    size_t capacity
+);
+void* Pool_Alloc(Pool* pool);
+void Pool_Free(Pool* pool, void* ptr);
+// Handle variants catch use-after-free: a handle goes stale once freed.
+PoolHandle Pool_AllocHandle(Pool* pool);
+void* Pool_Get(const Pool* pool, PoolHandle handle);
+void Pool_FreeHandle(Pool* pool, PoolHandle handle);
+PoolStats Pool_GetStats(const Pool* pool);
+
+/*
+ * Allocation tracing, compiled in with -DALLOC_TRACE.
+ *
+ * Each allocator entry point is wrapped in a macro that records the
+ * caller's __FILE__:__LINE__ before calling the real function, which is
+ * why the definitions spell their names in parentheses.  Every public
+ * function that can allocate is wrapped, and internal calls use the
+ * parenthesised names, so growth is never charged to an earlier call.
+ * Stats are kept per allocator and call site: number of calls, bytes
+ * requested, the largest single request, and for realloc-style growth the
+ * bytes of the old block that may have been copied.  Live bytes and their
+ * peak are tracked overall.
+ *
+ * The sorted report goes to stderr at exit, and whenever a signal
+ * registered with AllocTrace_ReportOnSignal has arrived since the last
+ * allocation.  Without ALLOC_TRACE everything compiles away.
+ */
+#ifdef ALLOC_TRACE
+
+#define ALLOC_TRACE_MAX_SITES 1024
+
+void AllocTrace_Here(const char* file, int line);
+void AllocTrace_Record(const char* allocator, size_t bytes, size_t copied);
+void AllocTrace_Release(size_t bytes);
+void AllocTrace_Report(FILE* out);
+void AllocTrace_ReportOnSignal(int signo);
+
+#define ALLOC_TRACE_CALL(fn, ...) \
+    (AllocTrace_Here(__FILE__, __LINE__), (fn)(__VA_ARGS__))
+
+#define Stack_AllocAlign(...) ALLOC_TRACE_CALL(Stack_AllocAlign, __VA_ARGS__)
+#define Stack_AllocAlignFlags(...) \
+    ALLOC_TRACE_CALL(Stack_AllocAlignFlags, __VA_ARGS__)
+#define Arena_AllocAlign(...) ALLOC_TRACE_CALL(Arena_AllocAlign, __VA_ARGS__)
+#define Arena_AllocAlignFlags(...) \
+    ALLOC_TRACE_CALL(Arena_AllocAlignFlags, __VA_ARGS__)
+#define VirtualStack_AllocAlign(...) \
+    ALLOC_TRACE_CALL(VirtualStack_AllocAlign, __VA_ARGS__)
+#define VirtualStack_Grow(...) ALLOC_TRACE_CALL(VirtualStack_Grow, __VA_ARGS__)
+// Pool slots come out of memory already counted here
+#define Pool_Init(...) ALLOC_TRACE_CALL(Pool_Init, __VA_ARGS__)
+
+#else
+
+#define AllocTrace_Record(allocator, bytes, copied) \
+    ((void)(allocator), (void)(bytes), (void)(copied))
+#define AllocTrace_Release(bytes) ((void)(bytes))
+#define AllocTrace_Report(out) ((void)0)
+#define AllocTrace_ReportOnSignal(signo) ((void)0)
+
+#endif /* ALLOC_TRACE */
+
+#endif /* ALLOC_H */
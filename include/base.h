@@ -0,0 +1,125 @@
+#ifndef BASE_H
+#define BASE_H
+
+/*
+ * Fixed-width aliases and plain data types shared by the math (types.h) and
+ * parsing (csv.h) modules.  No functions live here.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * SIMD backend selection.  The widest instruction set enabled by the compiler
+ * flags is used; define TYPES_NO_SIMD to force the scalar fallback.
+ */
+#if !defined(TYPES_NO_SIMD) && defined(__AVX2__)
+#define TYPES_SIMD_AVX2 1
+#define TYPES_SIMD_SSE2 1
+#include <immintrin.h>
+#elif !defined(TYPES_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define TYPES_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef size_t usize;
+
+typedef int8_t i8;
+typedef int16_t i16;
+typedef int32_t i32;
+typedef int64_t i64;
+typedef ssize_t isize;
+
+typedef float f32;
+typedef double f64;
+
+typedef enum {
+    SUCCESS,
+    FAILURE,
+} RETURN_STATUS;
+
+typedef struct Vec3 Vec3;
+typedef struct Vec4 Vec4;
+typedef struct Mat3 Mat3;
+typedef struct Mat4 Mat4;
+typedef struct Quat Quat;
+typedef struct Pose Pose;
+
+struct Vec3 {
+    f32 x;
+    f32 y;
+    f32 z;
+};
+
+struct Vec4 {
+    f32 x;
+    f32 y;
+    f32 z;
+    f32 w;
+};
+
+struct Mat3 {
+    Vec3 x_row;
+    Vec3 y_row;
+    Vec3 z_row;
+};
+
+struct Mat4 {
+    Vec4 x_row;
+    Vec4 y_row;
+    Vec4 z_row;
+    Vec4 w_row;
+};
+
+/* Unit quaternion; same layout as Vec4 with the scalar part last */
+struct Quat {
+    f32 x;
+    f32 y;
+    f32 z;
+    f32 w;
+};
+
+/* A single calibration pose: Rodrigues rotation vector plus translation */
+struct Pose {
+    u32 id;
+    u32 replicate_id;
+    Vec3 rvec;
+    Vec3 tvec;
+};
+
+/* Every SoA kernel (soa.h) processes SOA_LANES elements per step */
+#define SOA_LANES 8
+#define SOA_ALIGNMENT 64
+
+typedef struct Vec3SoA Vec3SoA;
+typedef struct PoseSoA PoseSoA;
+
+/*
+ * Structure-of-arrays storage for Vec3.  Each component array is
+ * SOA_ALIGNMENT aligned and holds `capacity` floats, where `capacity` is
+ * rounded up to a multiple of SOA_LANES so kernels never need a scalar tail.
+ * Lanes past `size` are padding and hold unspecified values after a kernel.
+ */
+struct Vec3SoA {
+    f32* x;
+    f32* y;
+    f32* z;
+    size_t size;
+    size_t capacity;
+};
+
+struct PoseSoA {
+    u32* id;
+    u32* replicate_id;
+    Vec3SoA rvec;
+    Vec3SoA tvec;
+    size_t size;
+};
+
+#endif /* BASE_H */
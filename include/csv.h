@@ -8,33 +8,85 @@
 #include <unistd.h>
 #include <stdbool.h>
 
+#include "alloc.h"
+#include "base.h"
+#include "str.h"
+
 typedef enum {
     EXIT_OK,
     EXIT_ERR,
 } EXIT_STATUS;
 
-typedef struct String String;
-typedef struct StringView StringView;
 typedef struct VecString VecString;
+typedef struct VecPose VecPose;
+typedef struct FileView FileView;
+typedef struct Span Span;
+typedef struct LineIndex LineIndex;
+typedef struct PoseCacheSource PoseCacheSource;
+typedef struct PoseCacheHeader PoseCacheHeader;
+typedef struct PoseCache PoseCache;
 
-/* A non-null terminated dynamic array of char */
-struct String {
-    char* items;
-    size_t size;
-    size_t capacity;
-};
-EXIT_STATUS String_Resize(String* str, size_t capacity);
-EXIT_STATUS String_Append(String* str, const char* other, size_t other_size);
 EXIT_STATUS String_ReadFile(String* str, const char* filepath);
 EXIT_STATUS String_Split(String* str, VecString* pieces, const char delim);
-void String_Reset(String* str);
-bool String_IsEmpty(String* str);
-void String_Free(String* str);
+EXIT_STATUS String_SplitIndex(
+    String* str, LineIndex* pieces, const char delim
+);
 
-struct StringView {
-    char* start;
+/* A piece of a larger buffer, relative to the start of that buffer */
+struct Span {
+    size_t offset;
     size_t length;
 };
+size_t StringView_ScanSpans(
+    StringView view,
+    const char delim,
+    Span* spans,
+    size_t max_spans,
+    size_t* consumed
+);
+size_t StringView_ScanFields(
+    StringView view,
+    const char field_delim,
+    const char line_delim,
+    Span* spans,
+    size_t max_spans,
+    size_t* consumed
+);
+StringView StringView_NextToken(StringView* rest, const char delim);
+StringView StringView_Trim(StringView view);
+EXIT_STATUS StringView_ParseU32(StringView view, u32* value);
+EXIT_STATUS StringView_ParseF32(StringView view, f32* value);
+
+/*
+ * Read-only contents of a whole file.  Regular files are memory-mapped so
+ * the data is never copied out of the page cache; pipes and other
+ * unmappable inputs are read onto the heap from the same descriptor.
+ */
+struct FileView {
+    StringView content;
+    bool mapped;
+};
+EXIT_STATUS FileView_Open(FileView* file, const char* filepath);
+void FileView_Close(FileView* file);
+
+/*
+ * The non-empty pieces of `source`, as one contiguous array of spans into
+ * it.  Nothing is copied, so `source` must outlive the index; spans stay
+ * valid if the source buffer moves, as long as `source` is updated.
+ */
+struct LineIndex {
+    StringView source;
+    Span* items;
+    size_t size;
+    size_t capacity;
+};
+EXIT_STATUS LineIndex_Build(
+    LineIndex* index, StringView source, const char delim
+);
+StringView LineIndex_Get(const LineIndex* index, size_t i);
+void LineIndex_Reset(LineIndex* index);
+bool LineIndex_IsEmpty(LineIndex* index);
+void LineIndex_Free(LineIndex* index);
 
 /* A dynamic array of String */
 struct VecString {
@@ -47,6 +99,111 @@ void VecString_Reset(VecString* vec);
 bool VecString_IsEmpty(VecString* vec);
 void VecString_Free(VecString* vec);
 
-//EXIT_STATUS get_poses(std::string* content, std::vector<Pose>* poses);
+/* A dynamic array of Pose */
+/*
+ * Heap backed by default.  With `arena` set, `items` is the arena's most
+ * recent allocation and grows in place; the arena owns the memory, and it
+ * must not be used for anything else while the vector grows.
+ */
+struct VecPose {
+    Pose* items;
+    size_t size;
+    size_t capacity;
+    VirtualStack* arena;
+};
+EXIT_STATUS VecPose_Reserve(VecPose* vec, size_t capacity);
+Pose* VecPose_Alloc(VecPose* vec);
+void VecPose_Reset(VecPose* vec);
+bool VecPose_IsEmpty(VecPose* vec);
+void VecPose_Free(VecPose* vec);
+
+/*
+ * Pose CSV: one pose per line as
+ *     id,replicate_id,rvec_x,rvec_y,rvec_z,tvec_x,tvec_y,tvec_z
+ * A first line whose first field is not a number is a header and is
+ * skipped; any other line that does not parse is an error.  With
+ * n_threads > 1 the content is split into line-aligned chunks parsed
+ * concurrently and merged in file order.  n_threads == 0 uses every online CPU, but only as many
+ * as give each thread at least a megabyte; an explicit count is used as is.
+ */
+EXIT_STATUS Poses_ParseCSV(StringView content, VecPose* poses);
+EXIT_STATUS Poses_ParseCSVParallel(
+    StringView content, VecPose* poses, size_t n_threads
+);
+EXIT_STATUS Poses_LoadCSV(
+    const char* filepath, VecPose* poses, size_t n_threads
+);
+
+/*
+ * Binary pose cache, laid out so a single read-only mmap can be used
+ * directly as a PoseSoA:
+ *
+ *     PoseCacheHeader                          (64 bytes)
+ *     u32 id[stride]
+ *     u32 replicate_id[stride]
+ *     f32 rvec_x[stride], rvec_y[stride], rvec_z[stride]
+ *     f32 tvec_x[stride], tvec_y[stride], tvec_z[stride]
+ *
+ * `stride` is `count` rounded up to 16 so every column is SOA_ALIGNMENT
+ * aligned and padded to whole SIMD lanes; padding is zero.  Values are
+ * stored in host byte order.  `checksum` covers all column bytes.
+ * `source` identifies the CSV the cache was built from.
+ */
+#define POSE_CACHE_MAGIC 0x45534F50u /* "POSE" */
+#define POSE_CACHE_VERSION 2
+#define POSE_CACHE_COLUMNS 8
+
+/* Size and modification time of a CSV; all zero when unknown */
+struct PoseCacheSource {
+    u64 size;
+    i64 mtime_sec;
+    i64 mtime_nsec;
+};
+
+struct PoseCacheHeader {
+    u32 magic;
+    u32 version;
+    u64 count;
+    u64 stride;
+    u64 data_offset;
+    u64 checksum;
+    PoseCacheSource source;
+};
+
+/* A loaded cache; `poses` points into the mapping and is read-only */
+struct PoseCache {
+    PoseSoA poses;
+    void* data;
+    size_t data_size;
+    bool mapped;
+};
+EXIT_STATUS PoseCache_Write(
+    const char* filepath,
+    const Pose* poses,
+    size_t count,
+    const PoseCacheSource* source
+);
+EXIT_STATUS PoseCache_Open(PoseCache* cache, const char* filepath);
+EXIT_STATUS PoseCache_Verify(const PoseCache* cache);
+void PoseCache_Close(PoseCache* cache);
+/*
+ * Load `csv_path` through its cache at `csv_path` + ".posecache", which is
+ * (re)built from the CSV whenever it is missing, invalid, or was built
+ * from a CSV of another size or modification time.  A matching cache is
+ * trusted as is; with `verify` its checksum is checked too, at the cost of
+ * reading every page, and a mismatch rebuilds it.  If the cache cannot be
+ * written the image is kept on the heap instead.
+ */
+EXIT_STATUS PoseCache_Load(
+    PoseCache* cache, const char* csv_path, size_t n_threads, bool verify
+);
+
+// See the allocation tracing notes in alloc.h
+#ifdef ALLOC_TRACE
+#define VecString_Alloc(...) ALLOC_TRACE_CALL(VecString_Alloc, __VA_ARGS__)
+#define VecPose_Reserve(...) ALLOC_TRACE_CALL(VecPose_Reserve, __VA_ARGS__)
+#define VecPose_Alloc(...) ALLOC_TRACE_CALL(VecPose_Alloc, __VA_ARGS__)
+#define LineIndex_Build(...) ALLOC_TRACE_CALL(LineIndex_Build, __VA_ARGS__)
+#endif /* ALLOC_TRACE */
 
 #endif /* CSV_H */
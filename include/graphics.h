@@ -4,18 +4,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc.h"
+#include "soa.h"
 #include "webgpu.h"
+#include "wgpu.h"
 
 // Forward declarations
 typedef struct GraphicsEngine GraphicsEngine;
 typedef struct Renderer Renderer;
+void graphics_engine_destroy(GraphicsEngine* engine);
 
 // Core structures
+// `width` and `height` are in pixels. Resizes are only flagged here and
+// applied once, before the next surface acquire.
 typedef struct {
     SDL_Window* window;
     int width;
     int height;
     bool should_quit;
+    bool resized;
+    bool minimized;
+    bool needs_redraw;  // Contents were damaged, e.g. uncovered
+    bool redraw_requested;  // By graphics_engine_request_redraw
+    uint32_t redraw_event;  // SDL event type it pushes
 } AppWindow;
 
 typedef struct {
@@ -26,18 +37,156 @@ typedef struct {
     WGPUSurface surface;
     WGPUTextureFormat surface_format;
     WGPUSurfaceConfiguration surface_config;
+    WGPUPresentMode present_mode;
 } WGPUContext;
 
+// Poses are drawn as axis triads: one shared line-list mesh plus one
+// instance per pose, all in a single instanced draw.
 typedef struct {
     WGPURenderPipeline pipeline;
     WGPUBuffer vertex_buffer;
+    WGPUBuffer instance_buffer;
+    WGPUBuffer uniform_buffer;
     WGPUBindGroup bind_group;
+    uint32_t vertex_count;
+    uint32_t instance_count;
 } RenderPipeline;
 
+// Attachments that follow the frame size. The color target only exists
+// headless; windowed frames render straight into the surface texture.
+typedef struct {
+    WGPUTexture depth_texture;
+    WGPUTextureView depth_view;
+    WGPUTexture color_texture;
+    WGPUTextureView color_view;
+    uint32_t width;
+    uint32_t height;
+} RenderTargets;
+
+// Fitted to the bounds of the loaded poses
+typedef struct {
+    Vec3 center;
+    float radius;
+    float axis_length;
+} Camera;
+
+// Streaming uploads. Each region is a MapWrite|CopySrc buffer that stays
+// mapped while the host fills it; at submit it is unmapped and its copies
+// are recorded, and the queue's work-done callback retires it for
+// remapping. A WebGPU buffer must be wholly unmapped to be used by a
+// submit, hence a buffer per region rather than ranges of one buffer.
+#define UPLOAD_RING_REGIONS 3
+#define UPLOAD_RING_REGION_SIZE (16 << 20)
+#define UPLOAD_RING_MAX_COPIES 256
+#define UPLOAD_ALIGNMENT 4
+
+typedef enum {
+    UPLOAD_REGION_MAPPED,     // Host writable
+    UPLOAD_REGION_IN_FLIGHT,  // Submitted, waiting on the queue
+    UPLOAD_REGION_RETIRED,    // Queue done, map not requested yet
+    UPLOAD_REGION_MAPPING,    // Map requested
+    UPLOAD_REGION_UNMAPPED,   // Map failed; requested again next frame
+} UPLOAD_REGION_STATE;
+
+typedef struct {
+    WGPUBuffer buffer;
+    uint8_t* data;
+    UPLOAD_REGION_STATE state;
+} UploadRegion;
+
+typedef struct {
+    WGPUBuffer dst;
+    uint64_t dst_offset;
+    uint64_t src_offset;
+    uint64_t size;
+} UploadCopy;
+
+typedef struct {
+    WGPUDevice device;
+    WGPUQueue queue;
+    UploadRegion regions[UPLOAD_RING_REGIONS];
+    UploadCopy copies[UPLOAD_RING_MAX_COPIES];
+    size_t region_size;
+    size_t current;
+    size_t offset;
+    size_t copy_count;
+    size_t bytes;
+    size_t submits;
+    size_t stalls;
+    size_t fallbacks;
+} UploadRing;
+
+// Latency/throughput trade-offs. A low-latency display wants Mailbox or
+// Immediate with one frame in flight; a background monitor wants Fifo and
+// a low frame cap.
+#define MAX_FRAMES_IN_FLIGHT_LIMIT UPLOAD_RING_REGIONS
+
+typedef struct GraphicsOptions {
+    WGPUPresentMode present_mode;   // Fifo if the surface lacks it
+    double max_fps;                 // 0 for no cap
+    uint32_t max_frames_in_flight;  // 1 .. MAX_FRAMES_IN_FLIGHT_LIMIT
+    bool continuous;                // Redraw every frame, for animation
+} GraphicsOptions;
+
+// Why the next frame has to be drawn. Outside continuous mode the loop
+// blocks on window events while none are set.
+typedef enum {
+    DIRTY_DATA = 1 << 0,
+    DIRTY_CAMERA = 1 << 1,
+    DIRTY_WINDOW = 1 << 2,
+    DIRTY_ALL = DIRTY_DATA | DIRTY_CAMERA | DIRTY_WINDOW,
+} DIRTY_FLAGS;
+
+// Upper bound on an idle wait, so GPU callbacks keep being serviced
+#define IDLE_WAIT_TIMEOUT_MS 250
+
+// Called by graphics_engine_run once per loop iteration, before it decides
+// whether to draw, with the seconds since the loop started. Poses streamed
+// from here with graphics_engine_update_poses land in the next frame.
+// Outside continuous mode the loop only iterates on events, idle timeouts
+// and redraw requests.
+typedef void (*GraphicsFrameCallback)(
+    GraphicsEngine* engine, double seconds, void* userdata
+);
+
+typedef struct {
+    WGPUSubmissionIndex submissions[MAX_FRAMES_IN_FLIGHT_LIMIT];
+    uint64_t submitted;
+    uint32_t max_frames_in_flight;
+    uint64_t frame_period_ns;
+    uint64_t next_frame_ns;
+} FramePacer;
+
+// Transient per-frame memory. There is a Stack for every frame that can be
+// in flight, reset wholesale when it comes round again. By then
+// frame_pacer_wait has retired the frame that used it, so whatever a frame
+// built stays valid while the GPU may still be consuming it.
+#define FRAME_ARENA_COUNT MAX_FRAMES_IN_FLIGHT_LIMIT
+#define FRAME_ARENA_SIZE (4 << 20)
+
+typedef struct {
+    Stack stacks[FRAME_ARENA_COUNT];
+    void* memory;
+    size_t current;
+    size_t high_water;
+    size_t frame_count;
+} FrameArena;
+
 struct GraphicsEngine {
     AppWindow window;
     WGPUContext wgpu;
     RenderPipeline pipeline;
+    RenderTargets targets;
+    Camera camera;
+    FrameArena frame_arena;
+    UploadRing upload;
+    FramePacer pacer;
+    GraphicsFrameCallback frame_callback;
+    void* frame_userdata;
+    size_t frames_presented;
+    uint32_t dirty;
+    bool continuous;
+    bool headless;
     bool initialized;
 };
 
@@ -46,6 +195,25 @@ typedef struct Vertex {
     float color[3];
 } Vertex;
 
+// Per-instance vertex data for one pose
+typedef struct PoseInstance {
+    float rotation[4];  // Unit quaternion, scalar last
+    float translation[3];
+} PoseInstance;
+
+// Matches `Camera` in shaders/pose_axes.wgsl
+typedef struct CameraUniform {
+    float view_proj[16];  // Column-major
+    float axis_length;
+    float padding[3];
+} CameraUniform;
+
+#define DEPTH_FORMAT WGPUTextureFormat_Depth24Plus
+#define HEADLESS_FORMAT WGPUTextureFormat_RGBA8Unorm
+#define CAMERA_FOV_Y 0.8f
+// Poses are converted to instances this many at a time
+#define POSE_CONVERT_CHUNK 1024
+
 char* load_shader(const char* path) {
     FILE* f = fopen(path, "rb");
     if (!f) {
@@ -90,6 +258,309 @@ static void log_error(const char* message) {
 
 static void log_info(const char* message) { printf("Info: %s\n", message); }
 
+// Frame arena
+static bool frame_arena_init(FrameArena* arena, size_t frame_size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->memory = malloc(frame_size * FRAME_ARENA_COUNT);
+    if (!arena->memory) {
+        log_error("Failed to allocate frame arena");
+        return false;
+    }
+    for (size_t i = 0; i < FRAME_ARENA_COUNT; ++i) {
+        Stack_Init(
+            &arena->stacks[i], (uint8_t*)arena->memory + i * frame_size,
+            frame_size
+        );
+    }
+    return true;
+}
+
+// Rotates to the next frame's Stack and empties it without clearing.
+static Stack* frame_arena_begin(FrameArena* arena) {
+    arena->current = (arena->current + 1) % FRAME_ARENA_COUNT;
+    arena->frame_count += 1;
+    Stack* stack = &arena->stacks[arena->current];
+    if (stack->offset > arena->high_water) {
+        arena->high_water = stack->offset;
+    }
+    Stack_Restore(stack, 0);
+    return stack;
+}
+
+// Frame memory is overwritten by its users, so it is not zeroed.
+void* frame_arena_alloc(
+    FrameArena* arena, size_t size, size_t alignment
+) {
+    return Stack_AllocAlignFlags(
+        &arena->stacks[arena->current], size, alignment, ALLOC_POISON
+    );
+}
+
+static void frame_arena_report(FrameArena* arena) {
+    for (size_t i = 0; i < FRAME_ARENA_COUNT; ++i) {
+        if (arena->stacks[i].offset > arena->high_water) {
+            arena->high_water = arena->stacks[i].offset;
+        }
+    }
+    printf(
+        "Info: Frame arena high-water mark: %zu of %zu bytes over %zu frames\n",
+        arena->high_water,
+        arena->stacks[0].capacity,
+        arena->frame_count
+    );
+}
+
+static void frame_arena_destroy(FrameArena* arena) {
+    if (!arena->memory) return;
+    frame_arena_report(arena);
+    free(arena->memory);
+    memset(arena, 0, sizeof(*arena));
+}
+
+// Upload ring
+static void upload_region_map_callback(
+    WGPUMapAsyncStatus status,
+    WGPUStringView msg,
+    void* userdata1,
+    void* userdata2
+) {
+    UploadRegion* region = userdata1;
+    if (status == WGPUMapAsyncStatus_Success) {
+        region->state = UPLOAD_REGION_MAPPED;
+    } else {
+        fprintf(
+            stderr, "Failed to map upload region: %.*s\n",
+            (int)msg.length, msg.data
+        );
+        region->state = UPLOAD_REGION_UNMAPPED;
+    }
+}
+
+static void upload_region_done_callback(
+    WGPUQueueWorkDoneStatus status, void* userdata1, void* userdata2
+) {
+    UploadRegion* region = userdata1;
+    region->state = UPLOAD_REGION_RETIRED;
+}
+
+static void upload_region_map(UploadRing* ring, UploadRegion* region) {
+    region->state = UPLOAD_REGION_MAPPING;
+    WGPUBufferMapCallbackInfo map_cb_info = {
+        .mode = WGPUCallbackMode_AllowSpontaneous,
+        .callback = upload_region_map_callback,
+        .userdata1 = region,
+        .userdata2 = NULL,
+    };
+    wgpuBufferMapAsync(
+        region->buffer, WGPUMapMode_Write, 0, ring->region_size, map_cb_info
+    );
+}
+
+static bool upload_ring_init(
+    UploadRing* ring, WGPUDevice device, WGPUQueue queue, size_t region_size
+) {
+    memset(ring, 0, sizeof(*ring));
+    ring->device = device;
+    ring->queue = queue;
+    ring->region_size = region_size;
+    for (size_t i = 0; i < UPLOAD_RING_REGIONS; ++i) {
+        WGPUBufferDescriptor buffer_desc = {
+            .label = {"Upload Region", WGPU_STRLEN},
+            .usage = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc,
+            .size = region_size,
+            .mappedAtCreation = true,
+        };
+        UploadRegion* region = &ring->regions[i];
+        region->buffer = wgpuDeviceCreateBuffer(device, &buffer_desc);
+        if (!region->buffer) {
+            log_error("Failed to create upload region");
+            return false;
+        }
+        region->state = UPLOAD_REGION_MAPPED;
+    }
+    return true;
+}
+
+// Fires pending callbacks without blocking and requests maps for regions
+// the queue has finished with, so they are ready before they come round.
+static void upload_ring_poll(UploadRing* ring) {
+    wgpuDevicePoll(ring->device, false, NULL);
+    for (size_t i = 0; i < UPLOAD_RING_REGIONS; ++i) {
+        UploadRegion* region = &ring->regions[i];
+        if (region->state == UPLOAD_REGION_RETIRED ||
+            region->state == UPLOAD_REGION_UNMAPPED) {
+            upload_region_map(ring, region);
+        }
+    }
+}
+
+// Waits until the current region is writable. False if its map failed.
+static bool upload_ring_acquire(UploadRing* ring) {
+    UploadRegion* region = &ring->regions[ring->current];
+    if (region->state != UPLOAD_REGION_MAPPED) {
+        ring->stalls += 1;
+        if (region->state == UPLOAD_REGION_UNMAPPED) {
+            upload_region_map(ring, region);
+        }
+    }
+    while (region->state == UPLOAD_REGION_IN_FLIGHT ||
+           region->state == UPLOAD_REGION_RETIRED ||
+           region->state == UPLOAD_REGION_MAPPING) {
+        if (region->state == UPLOAD_REGION_RETIRED) {
+            upload_region_map(ring, region);
+        }
+        wgpuDevicePoll(ring->device, true, NULL);
+    }
+    if (region->state != UPLOAD_REGION_MAPPED) {
+        return false;
+    }
+    if (!region->data) {
+        region->data =
+            wgpuBufferGetMappedRange(region->buffer, 0, ring->region_size);
+    }
+    return region->data != NULL;
+}
+
+// Space for `size` bytes that are copied to `dst` at `dst_offset` when the
+// frame is submitted. Sizes and offsets must be multiples of
+// UPLOAD_ALIGNMENT. NULL when the region is full; the caller falls back to
+// wgpuQueueWriteBuffer.
+static void* upload_ring_alloc(
+    UploadRing* ring, WGPUBuffer dst, uint64_t dst_offset, size_t size
+) {
+    assert(size % UPLOAD_ALIGNMENT == 0 && dst_offset % UPLOAD_ALIGNMENT == 0);
+    if (size == 0) {
+        return NULL;
+    }
+    if (size > ring->region_size - ring->offset ||
+        ring->copy_count == UPLOAD_RING_MAX_COPIES ||
+        !upload_ring_acquire(ring)) {
+        ring->fallbacks += 1;
+        return NULL;
+    }
+    UploadRegion* region = &ring->regions[ring->current];
+    UploadCopy* last =
+        ring->copy_count > 0 ? &ring->copies[ring->copy_count - 1] : NULL;
+    if (last && last->dst == dst &&
+        last->src_offset + last->size == ring->offset &&
+        last->dst_offset + last->size == dst_offset) {
+        // Contiguous with the previous write; one copy covers both
+        last->size += size;
+    } else {
+        ring->copies[ring->copy_count++] = (UploadCopy){
+            .dst = dst,
+            .dst_offset = dst_offset,
+            .src_offset = ring->offset,
+            .size = size,
+        };
+    }
+    void* ptr = region->data + ring->offset;
+    ring->offset += size;
+    ring->bytes += size;
+    return ptr;
+}
+
+// Unmaps the current region and records its copies ahead of anything else
+// in `encoder`. Regions without writes stay mapped for the next frame.
+static void upload_ring_flush(UploadRing* ring, WGPUCommandEncoder encoder) {
+    UploadRegion* region = &ring->regions[ring->current];
+    if (ring->copy_count == 0 || region->state != UPLOAD_REGION_MAPPED) {
+        return;
+    }
+    wgpuBufferUnmap(region->buffer);
+    region->data = NULL;
+    for (size_t i = 0; i < ring->copy_count; ++i) {
+        UploadCopy* copy = &ring->copies[i];
+        wgpuCommandEncoderCopyBufferToBuffer(
+            encoder,
+            region->buffer,
+            copy->src_offset,
+            copy->dst,
+            copy->dst_offset,
+            copy->size
+        );
+    }
+    region->state = UPLOAD_REGION_IN_FLIGHT;
+}
+
+// Call after submitting the encoder passed to upload_ring_flush
+static void upload_ring_submitted(UploadRing* ring) {
+    UploadRegion* region = &ring->regions[ring->current];
+    if (region->state != UPLOAD_REGION_IN_FLIGHT) {
+        return;
+    }
+    WGPUQueueWorkDoneCallbackInfo done_cb_info = {
+        .mode = WGPUCallbackMode_AllowSpontaneous,
+        .callback = upload_region_done_callback,
+        .userdata1 = region,
+        .userdata2 = NULL,
+    };
+    wgpuQueueOnSubmittedWorkDone(ring->queue, done_cb_info);
+    ring->current = (ring->current + 1) % UPLOAD_RING_REGIONS;
+    ring->offset = 0;
+    ring->copy_count = 0;
+    ring->submits += 1;
+}
+
+// Submits the pending copies on their own, so that a queue write or a
+// buffer replacement that follows cannot be overtaken by them
+static void upload_ring_submit(UploadRing* ring) {
+    if (ring->copy_count == 0) {
+        return;
+    }
+    WGPUCommandEncoderDescriptor cmd_encoder_desc = {
+        .label = {"Upload Encoder", WGPU_STRLEN}
+    };
+    WGPUCommandEncoder encoder =
+        wgpuDeviceCreateCommandEncoder(ring->device, &cmd_encoder_desc);
+    upload_ring_flush(ring, encoder);
+    WGPUCommandBufferDescriptor cmd_buffer_desc = {
+        .label = {"Upload Command Buffer", WGPU_STRLEN}
+    };
+    WGPUCommandBuffer command_buffer =
+        wgpuCommandEncoderFinish(encoder, &cmd_buffer_desc);
+    wgpuQueueSubmit(ring->queue, 1, &command_buffer);
+    upload_ring_submitted(ring);
+    wgpuCommandBufferRelease(command_buffer);
+    wgpuCommandEncoderRelease(encoder);
+}
+
+// Drops the pending copies into `dst`, which is about to be destroyed
+static void upload_ring_discard(UploadRing* ring, WGPUBuffer dst) {
+    size_t kept = 0;
+    for (size_t i = 0; i < ring->copy_count; ++i) {
+        if (ring->copies[i].dst != dst) {
+            ring->copies[kept++] = ring->copies[i];
+        }
+    }
+    ring->copy_count = kept;
+    if (kept == 0) {
+        ring->offset = 0;
+    }
+}
+
+static void upload_ring_destroy(UploadRing* ring) {
+    if (!ring->device) return;
+    printf(
+        "Info: Upload ring: %zu bytes in %zu submits, %zu stalls, "
+        "%zu fallbacks\n",
+        ring->bytes,
+        ring->submits,
+        ring->stalls,
+        ring->fallbacks
+    );
+    // Callbacks still hold pointers into the ring
+    for (size_t i = 0; i < UPLOAD_RING_REGIONS; ++i) {
+        UploadRegion* region = &ring->regions[i];
+        while (region->state == UPLOAD_REGION_IN_FLIGHT ||
+               region->state == UPLOAD_REGION_MAPPING) {
+            wgpuDevicePoll(ring->device, true, NULL);
+        }
+        if (region->buffer) wgpuBufferRelease(region->buffer);
+    }
+    memset(ring, 0, sizeof(*ring));
+}
+
 // Window management
 static bool window_init(
     AppWindow* window, const char* title, int width, int height
@@ -111,7 +582,14 @@ static bool window_init(
 
     window->width = width;
     window->height = height;
+    SDL_GetWindowSizeInPixels(window->window, &window->width, &window->height);
     window->should_quit = false;
+    window->resized = false;
+    window->minimized = false;
+    window->redraw_event = SDL_RegisterEvents(1);
+    if (window->redraw_event == 0) {
+        window->redraw_event = SDL_EVENT_USER;
+    }
 
     SDL_LogInfo(log_category, "Window initialized successfully");
     return true;
@@ -134,19 +612,42 @@ static void window_handle_events(AppWindow* window) {
                 window->should_quit = true;
                 break;
             case SDL_EVENT_WINDOW_RESIZED:
-                window->width = event.window.data1;
-                window->height = event.window.data2;
-                // TODO: Handle resize - reconfigure surface
+            case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+                // Coalesced; the new size is read when it is applied
+                window->resized = true;
+                break;
+            case SDL_EVENT_WINDOW_MINIMIZED:
+                window->minimized = true;
+                break;
+            case SDL_EVENT_WINDOW_RESTORED:
+                window->minimized = false;
+                window->resized = true;
+                break;
+            case SDL_EVENT_WINDOW_SHOWN:
+            case SDL_EVENT_WINDOW_EXPOSED:
+                window->needs_redraw = true;
                 break;
             case SDL_EVENT_KEY_DOWN:
                 if (event.key.key == SDLK_ESCAPE) {
                     window->should_quit = true;
                 }
                 break;
+            default:
+                if (event.type == window->redraw_event) {
+                    window->redraw_requested = true;
+                }
+                break;
         }
     }
 }
 
+// Filled in by the request callbacks; `done` is set on failure too, so
+// waiting on it cannot spin forever when no adapter or device is available
+typedef struct {
+    void* handle;
+    bool done;
+} WGPURequest;
+
 // WGPU callback functions
 static void adapter_request_callback(
     WGPURequestAdapterStatus status,
@@ -155,8 +656,10 @@ static void adapter_request_callback(
     void* userdata1,
     void* userdata2
 ) {
+    WGPURequest* request = (WGPURequest*)userdata1;
+    request->done = true;
     if (status == WGPURequestAdapterStatus_Success) {
-        *(WGPUAdapter*)userdata1 = adapter;
+        request->handle = adapter;
         printf("Adapter acquired successfully");
     } else {
         fprintf(
@@ -172,9 +675,11 @@ static void device_request_callback(
     void* userdata1,
     void* userdata2
 ) {
+    WGPURequest* request = (WGPURequest*)userdata1;
+    request->done = true;
     if (status == WGPURequestDeviceStatus_Success) {
-        *(WGPUDevice*)userdata1 = device;
-        printf("Adapter acquired successfully");
+        request->handle = device;
+        printf("Device acquired successfully");
     } else {
         fprintf(
             stderr, "Failed to acquire device: %.*s", (int)msg.length, msg.data
@@ -319,7 +824,55 @@ static WGPUSurface create_surface_macos(
 }
 #endif
 
-// WGPU initialization
+static void log_adapter_info(WGPUAdapter adapter) {
+    WGPUAdapterInfo info = {0};
+    if (wgpuAdapterGetInfo(adapter, &info) != WGPUStatus_Success) {
+        return;
+    }
+    printf(
+        "Info: Using adapter %.*s (%.*s)\n",
+        (int)info.device.length,
+        info.device.data,
+        (int)info.description.length,
+        info.description.data
+    );
+    wgpuAdapterInfoFreeMembers(info);
+}
+
+static const char* present_mode_name(WGPUPresentMode mode) {
+    switch (mode) {
+        case WGPUPresentMode_Fifo:
+            return "fifo";
+        case WGPUPresentMode_FifoRelaxed:
+            return "fifo-relaxed";
+        case WGPUPresentMode_Immediate:
+            return "immediate";
+        case WGPUPresentMode_Mailbox:
+            return "mailbox";
+        default:
+            return "undefined";
+    }
+}
+
+// Inverse of present_mode_name, for command line options
+bool graphics_present_mode_from_name(const char* name, WGPUPresentMode* mode) {
+    const WGPUPresentMode modes[] = {
+        WGPUPresentMode_Fifo,
+        WGPUPresentMode_FifoRelaxed,
+        WGPUPresentMode_Immediate,
+        WGPUPresentMode_Mailbox,
+    };
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+        if (strcmp(name, present_mode_name(modes[i])) == 0) {
+            *mode = modes[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// WGPU initialization. Without a window no surface is created and frames
+// are rendered offscreen in HEADLESS_FORMAT.
 static bool wgpu_init(WGPUContext* ctx, SDL_Window* window) {
     // Create WGPU instance
     WGPUInstanceDescriptor instance_desc = {0};
@@ -330,19 +883,21 @@ static bool wgpu_init(WGPUContext* ctx, SDL_Window* window) {
     }
 
     // Create platform-specific surface
+    if (window) {
 #ifdef _WIN32
-    ctx->surface = create_surface_windows(ctx->instance, window);
+        ctx->surface = create_surface_windows(ctx->instance, window);
 #elif defined(__linux__)
-    ctx->surface = create_surface_linux(ctx->instance, window);
+        ctx->surface = create_surface_linux(ctx->instance, window);
 #elif defined(__APPLE__)
-    ctx->surface = create_surface_macos(ctx->instance, window);
+        ctx->surface = create_surface_macos(ctx->instance, window);
 #else
 #error "Unsupported platform"
 #endif
 
-    if (!ctx->surface) {
-        log_error("Failed to create surface");
-        return false;
+        if (!ctx->surface) {
+            log_error("Failed to create surface");
+            return false;
+        }
     }
 
     // Request adapter
@@ -351,10 +906,10 @@ static bool wgpu_init(WGPUContext* ctx, SDL_Window* window) {
         .powerPreference = WGPUPowerPreference_HighPerformance
     };
 
-    ctx->adapter = NULL;
+    WGPURequest adapter_request = {0};
     WGPURequestAdapterCallbackInfo adapter_cb_info = {
         .callback = adapter_request_callback,
-        .userdata1 = &ctx->adapter,
+        .userdata1 = &adapter_request,
         .userdata2 = NULL,
     };
     wgpuInstanceRequestAdapter(
@@ -362,34 +917,68 @@ static bool wgpu_init(WGPUContext* ctx, SDL_Window* window) {
     );
 
     // Wait for adapter (in real app, you'd want async handling)
-    while (!ctx->adapter) {
+    while (!adapter_request.done) {
         wgpuInstanceProcessEvents(ctx->instance);
     }
+    ctx->adapter = (WGPUAdapter)adapter_request.handle;
+    if (!ctx->adapter) {
+        log_error("No suitable WGPU adapter found");
+        return false;
+    }
+    log_adapter_info(ctx->adapter);
 
     // Request device
     WGPUDeviceDescriptor device_desc = {.label = {"Main Device", WGPU_STRLEN}};
 
-    ctx->device = NULL;
+    WGPURequest device_request = {0};
     WGPURequestDeviceCallbackInfo device_cb_info = {
         .callback = device_request_callback,
-        .userdata1 = &ctx->device,
+        .userdata1 = &device_request,
         .userdata2 = NULL,
     };
     wgpuAdapterRequestDevice(ctx->adapter, &device_desc, device_cb_info);
 
     // Wait for device
-    while (!ctx->device) {
+    while (!device_request.done) {
         wgpuInstanceProcessEvents(ctx->instance);
     }
+    ctx->device = (WGPUDevice)device_request.handle;
+    if (!ctx->device) {
+        log_error("Failed to create WGPU device");
+        return false;
+    }
 
     // Get queue
     ctx->queue = wgpuDeviceGetQueue(ctx->device);
 
-    // Get preferred surface format
-    WGPUSurfaceCapabilities capabilities;
+    if (!ctx->surface) {
+        ctx->surface_format = HEADLESS_FORMAT;
+        log_info("WGPU context initialized headless");
+        return true;
+    }
+
+    // Get preferred surface format and check the requested present mode
+    WGPUSurfaceCapabilities capabilities = {0};
     wgpuSurfaceGetCapabilities(ctx->surface, ctx->adapter, &capabilities);
     ctx->surface_format = capabilities.formats[0];  // Use first available
 
+    bool present_mode_supported = false;
+    for (size_t i = 0; i < capabilities.presentModeCount; ++i) {
+        if (capabilities.presentModes[i] == ctx->present_mode) {
+            present_mode_supported = true;
+        }
+    }
+    if (!present_mode_supported) {
+        fprintf(
+            stderr,
+            "Warning: Present mode %s not supported, using fifo\n",
+            present_mode_name(ctx->present_mode)
+        );
+        ctx->present_mode = WGPUPresentMode_Fifo;
+    }
+    printf("Info: Present mode %s\n", present_mode_name(ctx->present_mode));
+    wgpuSurfaceCapabilitiesFreeMembers(capabilities);
+
     log_info("WGPU context initialized successfully");
     return true;
 }
@@ -401,7 +990,7 @@ static bool wgpu_configure_surface(WGPUContext* ctx, int width, int height) {
                                    .format = ctx->surface_format,
                                    .width = width,
                                    .height = height,
-                                   .presentMode = WGPUPresentMode_Fifo};
+                                   .presentMode = ctx->present_mode};
 
     wgpuSurfaceConfigure(ctx->surface, &ctx->surface_config);
     log_info("Surface configured successfully");
@@ -419,17 +1008,22 @@ static void wgpu_destroy(WGPUContext* ctx) {
 
 
 static bool create_vertex_buffer(GraphicsEngine* engine) {
+    // Unit axis triad, X red, Y green, Z blue; the shader scales it by the
+    // camera's axis length
     Vertex vertices[] = {
-        {{0.0f, 0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
-        {{-0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-        {{0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+        {{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+        {{1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+        {{0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+        {{0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+        {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+        {{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f}},
     };
 
     WGPUBufferDescriptor buffer_desc = {
         .label = {"Vertex Buffer", WGPU_STRLEN},
-        .usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst,
+        .usage = WGPUBufferUsage_Vertex,
         .size = sizeof(vertices),
-        .mappedAtCreation = false,
+        .mappedAtCreation = true,
     };
 
     engine->pipeline.vertex_buffer =
@@ -439,17 +1033,57 @@ static bool create_vertex_buffer(GraphicsEngine* engine) {
         return false;
     }
 
-    wgpuQueueWriteBuffer(
-        engine->wgpu.queue,
-        engine->pipeline.vertex_buffer,
-        0,
+    memcpy(
+        wgpuBufferGetMappedRange(
+            engine->pipeline.vertex_buffer, 0, sizeof(vertices)
+        ),
         vertices,
         sizeof(vertices)
     );
+    wgpuBufferUnmap(engine->pipeline.vertex_buffer);
+    engine->pipeline.vertex_count = sizeof(vertices) / sizeof(vertices[0]);
     SDL_LogInfo(SDL_LOG_CATEGORY_VIDEO, "Vertex buffer created successfully");
     return true;
 }
 
+static bool create_camera_bind_group(GraphicsEngine* engine) {
+    WGPUBufferDescriptor buffer_desc = {
+        .label = {"Camera Uniform", WGPU_STRLEN},
+        .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst,
+        .size = sizeof(CameraUniform),
+        .mappedAtCreation = false,
+    };
+    engine->pipeline.uniform_buffer =
+        wgpuDeviceCreateBuffer(engine->wgpu.device, &buffer_desc);
+    if (!engine->pipeline.uniform_buffer) {
+        log_error("Failed to create camera uniform buffer");
+        return false;
+    }
+
+    WGPUBindGroupLayout layout =
+        wgpuRenderPipelineGetBindGroupLayout(engine->pipeline.pipeline, 0);
+    WGPUBindGroupEntry entry = {
+        .binding = 0,
+        .buffer = engine->pipeline.uniform_buffer,
+        .offset = 0,
+        .size = sizeof(CameraUniform),
+    };
+    WGPUBindGroupDescriptor bind_group_desc = {
+        .label = {"Camera Bind Group", WGPU_STRLEN},
+        .layout = layout,
+        .entryCount = 1,
+        .entries = &entry,
+    };
+    engine->pipeline.bind_group =
+        wgpuDeviceCreateBindGroup(engine->wgpu.device, &bind_group_desc);
+    wgpuBindGroupLayoutRelease(layout);
+    if (!engine->pipeline.bind_group) {
+        log_error("Failed to create camera bind group");
+        return false;
+    }
+    return true;
+}
+
 static bool create_render_pipeline(GraphicsEngine* engine) {
     // Create the vertex buffer
     if (!create_vertex_buffer(engine)) {
@@ -457,7 +1091,7 @@ static bool create_render_pipeline(GraphicsEngine* engine) {
     }
 
     // Create shaders
-    char* shader_source = load_shader("shaders/color_triangle.wgsl");
+    char* shader_source = load_shader("shaders/pose_axes.wgsl");
     if(!shader_source) {
         return false;
     }
@@ -479,7 +1113,8 @@ static bool create_render_pipeline(GraphicsEngine* engine) {
     WGPUShaderModule fragment_shader =
         wgpuDeviceCreateShaderModule(engine->wgpu.device, &fs_desc);
 
-    // Define vertex attributes
+    // Define vertex attributes: the mesh steps per vertex, the pose per
+    // instance
     WGPUVertexAttribute vertex_attributes[] = {
         {
             .format = WGPUVertexFormat_Float32x3,
@@ -492,13 +1127,33 @@ static bool create_render_pipeline(GraphicsEngine* engine) {
             .shaderLocation = 1,
         },
     };
+    WGPUVertexAttribute instance_attributes[] = {
+        {
+            .format = WGPUVertexFormat_Float32x4,
+            .offset = offsetof(PoseInstance, rotation),
+            .shaderLocation = 2,
+        },
+        {
+            .format = WGPUVertexFormat_Float32x3,
+            .offset = offsetof(PoseInstance, translation),
+            .shaderLocation = 3,
+        },
+    };
 
-    // Define vertex buffer layout
-    WGPUVertexBufferLayout vertex_buffer_layout = {
-        .arrayStride = sizeof(Vertex),
-        .stepMode = WGPUVertexStepMode_Vertex,
-        .attributeCount = 2,
-        .attributes = vertex_attributes,
+    // Define vertex buffer layouts
+    WGPUVertexBufferLayout vertex_buffer_layouts[] = {
+        {
+            .arrayStride = sizeof(Vertex),
+            .stepMode = WGPUVertexStepMode_Vertex,
+            .attributeCount = 2,
+            .attributes = vertex_attributes,
+        },
+        {
+            .arrayStride = sizeof(PoseInstance),
+            .stepMode = WGPUVertexStepMode_Instance,
+            .attributeCount = 2,
+            .attributes = instance_attributes,
+        },
     };
 
     WGPUColorTargetState color_target_state = {
@@ -511,18 +1166,26 @@ static bool create_render_pipeline(GraphicsEngine* engine) {
         .targetCount = 1,
         .targets = &color_target_state,
     };
+    WGPUDepthStencilState depth_state = {
+        .format = DEPTH_FORMAT,
+        .depthWriteEnabled = WGPUOptionalBool_True,
+        .depthCompare = WGPUCompareFunction_Less,
+        .stencilFront = {.compare = WGPUCompareFunction_Always},
+        .stencilBack = {.compare = WGPUCompareFunction_Always},
+    };
     // Create render pipeline
     WGPURenderPipelineDescriptor pipeline_desc = {
-        .label = {"Basic Pipeline", WGPU_STRLEN},
+        .label = {"Pose Axes Pipeline", WGPU_STRLEN},
         .vertex =
             {
                 .module = vertex_shader,
                 .entryPoint = {"vs_main", WGPU_STRLEN},
-                .bufferCount = 1,
-                .buffers = &vertex_buffer_layout,
+                .bufferCount = 2,
+                .buffers = vertex_buffer_layouts,
             },
         .fragment = &frag_state,
-        .primitive = {.topology = WGPUPrimitiveTopology_TriangleList},
+        .primitive = {.topology = WGPUPrimitiveTopology_LineList},
+        .depthStencil = &depth_state,
         .multisample = {.count = 1, .mask = 0xFFFFFFFF}
     };
 
@@ -538,14 +1201,405 @@ static bool create_render_pipeline(GraphicsEngine* engine) {
         log_error("Failed to create render pipeline");
         return false;
     }
+    if (!create_camera_bind_group(engine)) {
+        return false;
+    }
 
     log_info("Render pipeline created successfully");
     return true;
 }
 
+// Render targets
+static WGPUTexture create_target_texture(
+    WGPUDevice device,
+    const char* label,
+    WGPUTextureFormat format,
+    WGPUTextureUsage usage,
+    uint32_t width,
+    uint32_t height
+) {
+    WGPUTextureDescriptor texture_desc = {
+        .label = {label, WGPU_STRLEN},
+        .usage = usage,
+        .dimension = WGPUTextureDimension_2D,
+        .size = {width, height, 1},
+        .format = format,
+        .mipLevelCount = 1,
+        .sampleCount = 1,
+    };
+    return wgpuDeviceCreateTexture(device, &texture_desc);
+}
+
+static void destroy_render_targets(RenderTargets* targets) {
+    if (targets->depth_view) wgpuTextureViewRelease(targets->depth_view);
+    if (targets->depth_texture) {
+        wgpuTextureDestroy(targets->depth_texture);
+        wgpuTextureRelease(targets->depth_texture);
+    }
+    if (targets->color_view) wgpuTextureViewRelease(targets->color_view);
+    if (targets->color_texture) {
+        wgpuTextureDestroy(targets->color_texture);
+        wgpuTextureRelease(targets->color_texture);
+    }
+    memset(targets, 0, sizeof(*targets));
+}
+
+static bool create_render_targets(
+    GraphicsEngine* engine, uint32_t width, uint32_t height
+) {
+    RenderTargets* targets = &engine->targets;
+    destroy_render_targets(targets);
+
+    targets->depth_texture = create_target_texture(
+        engine->wgpu.device,
+        "Depth Texture",
+        DEPTH_FORMAT,
+        WGPUTextureUsage_RenderAttachment,
+        width,
+        height
+    );
+    if (!targets->depth_texture) {
+        log_error("Failed to create depth texture");
+        return false;
+    }
+    targets->depth_view = wgpuTextureCreateView(targets->depth_texture, NULL);
+
+    if (engine->headless) {
+        targets->color_texture = create_target_texture(
+            engine->wgpu.device,
+            "Offscreen Color Texture",
+            HEADLESS_FORMAT,
+            WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
+            width,
+            height
+        );
+        if (!targets->color_texture) {
+            log_error("Failed to create offscreen color texture");
+            return false;
+        }
+        targets->color_view =
+            wgpuTextureCreateView(targets->color_texture, NULL);
+    }
+
+    targets->width = width;
+    targets->height = height;
+    return true;
+}
+
+// Camera
+static Mat4 camera_look_at(Vec3 eye, Vec3 target, Vec3 up) {
+    Vec3 f = Vec3_Normalize(Vec3_Sub(target, eye));
+    Vec3 s = Vec3_Normalize(Vec3_Cross(f, up));
+    Vec3 u = Vec3_Cross(s, f);
+    return (Mat4){
+        .x_row = {s.x, s.y, s.z, -Vec3_Dot(s, eye)},
+        .y_row = {u.x, u.y, u.z, -Vec3_Dot(u, eye)},
+        .z_row = {-f.x, -f.y, -f.z, Vec3_Dot(f, eye)},
+        .w_row = {0.0f, 0.0f, 0.0f, 1.0f},
+    };
+}
+
+// Right-handed, with depth mapped to [0, 1] as WebGPU expects
+static Mat4 camera_perspective(
+    float fov_y, float aspect, float near, float far
+) {
+    float y = 1.0f / tanf(0.5f * fov_y);
+    return (Mat4){
+        .x_row = {y / aspect, 0.0f, 0.0f, 0.0f},
+        .y_row = {0.0f, y, 0.0f, 0.0f},
+        .z_row = {0.0f, 0.0f, far / (near - far), near * far / (near - far)},
+        .w_row = {0.0f, 0.0f, -1.0f, 0.0f},
+    };
+}
+
+// Bounds of the first `count` translations. Axes are sized to about half
+// the average spacing between poses.
+static void camera_fit(Camera* camera, const PoseSoA* poses, size_t count) {
+    if (count == 0) {
+        *camera = (Camera){.radius = 1.0f, .axis_length = 0.1f};
+        return;
+    }
+    Vec3 min = Vec3SoA_Get(&poses->tvec, 0);
+    Vec3 max = min;
+    for (size_t i = 1; i < count; ++i) {
+        Vec3 t = Vec3SoA_Get(&poses->tvec, i);
+        min = (Vec3){fminf(min.x, t.x), fminf(min.y, t.y), fminf(min.z, t.z)};
+        max = (Vec3){fmaxf(max.x, t.x), fmaxf(max.y, t.y), fmaxf(max.z, t.z)};
+    }
+    camera->center = Vec3_Scale(Vec3_Add(min, max), 0.5f);
+    camera->radius = 0.5f * Vec3_Mag(Vec3_Sub(max, min));
+    if (camera->radius < 1e-6f) {
+        camera->radius = 1.0f;
+    }
+    camera->axis_length = camera->radius / cbrtf((float)count);
+    if (camera->axis_length > 0.1f * camera->radius) {
+        camera->axis_length = 0.1f * camera->radius;
+    }
+}
+
+// Views the scene from behind and above its center, OpenCV style (y down,
+// z forward), fitting the bounding sphere in both directions
+static void camera_upload(GraphicsEngine* engine) {
+    Camera* camera = &engine->camera;
+    float width = (float)engine->targets.width;
+    float height = (float)engine->targets.height;
+    float aspect = height > 0.0f ? width / height : 1.0f;
+    float half_fov = 0.5f * CAMERA_FOV_Y;
+    float half_fov_x = atanf(aspect * tanf(half_fov));
+    if (half_fov_x < half_fov) half_fov = half_fov_x;
+
+    float radius = camera->radius + camera->axis_length;
+    float distance = radius / sinf(half_fov);
+    Vec3 direction = Vec3_Normalize((Vec3){0.4f, -0.5f, -1.0f});
+    Vec3 eye = Vec3_Add(camera->center, Vec3_Scale(direction, distance));
+    float near = distance - radius;
+    if (near < 1e-3f * distance) near = 1e-3f * distance;
+
+    Mat4 view = camera_look_at(eye, camera->center, (Vec3){0.0f, -1.0f, 0.0f});
+    Mat4 proj =
+        camera_perspective(CAMERA_FOV_Y, aspect, near, distance + radius);
+    Mat4 columns = Mat4_Transpose(Mat4_Mul(proj, view));
+
+    CameraUniform uniform = {.axis_length = camera->axis_length};
+    memcpy(uniform.view_proj, &columns, sizeof(uniform.view_proj));
+    wgpuQueueWriteBuffer(
+        engine->wgpu.queue,
+        engine->pipeline.uniform_buffer,
+        0,
+        &uniform,
+        sizeof(uniform)
+    );
+    engine->dirty |= DIRTY_CAMERA;
+}
+
+// Poses
+// Instances `first` .. `first + count` into `out`; `first` must be a
+// multiple of SOA_LANES so every chunk stays lane aligned.
+static void fill_pose_instances(
+    PoseInstance* out, const PoseSoA* poses, size_t first, size_t count
+) {
+    Quat quats[POSE_CONVERT_CHUNK];
+    size_t end = first + count;
+    for (size_t begin = first; begin < end; begin += POSE_CONVERT_CHUNK) {
+        size_t n = end - begin < POSE_CONVERT_CHUNK ? end - begin
+                                                    : POSE_CONVERT_CHUNK;
+        // An aligned chunk can be viewed as its own SoA
+        Vec3SoA rvecs = {
+            .x = poses->rvec.x + begin,
+            .y = poses->rvec.y + begin,
+            .z = poses->rvec.z + begin,
+            .size = n,
+            .capacity = SoA_PaddedCount(n),
+        };
+        Vec3SoA_RotVecToQuat(&rvecs, quats);
+        for (size_t i = 0; i < n; ++i) {
+            size_t index = begin + i;
+            out[index - first] = (PoseInstance){
+                .rotation = {quats[i].x, quats[i].y, quats[i].z, quats[i].w},
+                .translation =
+                    {poses->tvec.x[index],
+                     poses->tvec.y[index],
+                     poses->tvec.z[index]},
+            };
+        }
+    }
+}
+
+// Replaces the drawn poses. Instances are written straight into the
+// buffer's mapping at creation, without a staging copy.
+bool graphics_engine_set_poses(GraphicsEngine* engine, const PoseSoA* poses) {
+    RenderPipeline* pipeline = &engine->pipeline;
+    if (pipeline->instance_buffer) {
+        // Queued updates would otherwise copy into a destroyed buffer
+        upload_ring_discard(&engine->upload, pipeline->instance_buffer);
+        wgpuBufferDestroy(pipeline->instance_buffer);
+        wgpuBufferRelease(pipeline->instance_buffer);
+        pipeline->instance_buffer = NULL;
+    }
+    pipeline->instance_count = 0;
+    engine->dirty |= DIRTY_DATA;
+
+    WGPULimits limits = {0};
+    wgpuDeviceGetLimits(engine->wgpu.device, &limits);
+    size_t count = poses->size;
+    size_t max_count = limits.maxBufferSize / sizeof(PoseInstance);
+    if (max_count > UINT32_MAX) max_count = UINT32_MAX;
+    if (count > max_count) {
+        fprintf(
+            stderr,
+            "Warning: Drawing the first %zu of %zu poses (buffer limit)\n",
+            max_count,
+            count
+        );
+        count = max_count;
+    }
+    camera_fit(&engine->camera, poses, count);
+    camera_upload(engine);
+    if (count == 0) {
+        return true;
+    }
+
+    WGPUBufferDescriptor buffer_desc = {
+        .label = {"Pose Instance Buffer", WGPU_STRLEN},
+        .usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst,
+        .size = count * sizeof(PoseInstance),
+        .mappedAtCreation = true,
+    };
+    pipeline->instance_buffer =
+        wgpuDeviceCreateBuffer(engine->wgpu.device, &buffer_desc);
+    if (!pipeline->instance_buffer) {
+        log_error("Failed to create pose instance buffer");
+        return false;
+    }
+    PoseInstance* instances = wgpuBufferGetMappedRange(
+        pipeline->instance_buffer, 0, buffer_desc.size
+    );
+    fill_pose_instances(instances, poses, 0, count);
+    wgpuBufferUnmap(pipeline->instance_buffer);
+
+    pipeline->instance_count = (uint32_t)count;
+    printf("Info: Uploaded %zu pose instances\n", count);
+    return true;
+}
+
+// Streams poses `first` .. `first + count` of the set given to
+// graphics_engine_set_poses into the instance buffer. They are converted
+// straight into the upload ring and copied on the next submit; what does
+// not fit in the ring goes through wgpuQueueWriteBuffer instead, after
+// the copies already queued, so later updates always win.
+void graphics_engine_update_poses(
+    GraphicsEngine* engine, const PoseSoA* poses, size_t first, size_t count
+) {
+    RenderPipeline* pipeline = &engine->pipeline;
+    if (first >= pipeline->instance_count) {
+        return;
+    }
+    if (count > pipeline->instance_count - first) {
+        count = pipeline->instance_count - first;
+    }
+    size_t aligned = first & ~(size_t)(SOA_LANES - 1);
+    count += first - aligned;
+    engine->dirty |= DIRTY_DATA;
+
+    for (size_t begin = aligned; begin < aligned + count;) {
+        size_t n = aligned + count - begin;
+        size_t fit = ((engine->upload.region_size - engine->upload.offset) /
+                      sizeof(PoseInstance)) &
+                     ~(size_t)(SOA_LANES - 1);
+        if (fit > 0 && n > fit) n = fit;
+        void* dst = upload_ring_alloc(
+            &engine->upload,
+            pipeline->instance_buffer,
+            begin * sizeof(PoseInstance),
+            n * sizeof(PoseInstance)
+        );
+        if (dst) {
+            fill_pose_instances(dst, poses, begin, n);
+            begin += n;
+            continue;
+        }
+
+        // A queue write executes ahead of the next submit, so copies still
+        // waiting for it would land on top of this newer data
+        upload_ring_submit(&engine->upload);
+        PoseInstance instances[POSE_CONVERT_CHUNK];
+        n = n < POSE_CONVERT_CHUNK ? n : POSE_CONVERT_CHUNK;
+        fill_pose_instances(instances, poses, begin, n);
+        wgpuQueueWriteBuffer(
+            engine->wgpu.queue,
+            pipeline->instance_buffer,
+            begin * sizeof(PoseInstance),
+            instances,
+            n * sizeof(PoseInstance)
+        );
+        begin += n;
+    }
+}
+
+void graphics_engine_set_frame_callback(
+    GraphicsEngine* engine, GraphicsFrameCallback callback, void* userdata
+) {
+    engine->frame_callback = callback;
+    engine->frame_userdata = userdata;
+}
+
+// Asks for a frame after a change the engine cannot see, such as new data
+// from a worker thread. Safe to call from any thread: it only pushes an
+// SDL event, which also wakes a loop idling in SDL_WaitEventTimeout.
+// Headless engines draw on graphics_engine_capture only, so it is a no-op.
+void graphics_engine_request_redraw(GraphicsEngine* engine) {
+    if (engine->headless) {
+        return;
+    }
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = engine->window.redraw_event;
+    if (!SDL_PushEvent(&event)) {
+        SDL_LogError(
+            SDL_LOG_CATEGORY_VIDEO, "SDL_PushEvent: %s\n", SDL_GetError()
+        );
+    }
+}
+
 // Main graphics engine functions
-GraphicsEngine* graphics_engine_create(
-    const char* title, int width, int height
+GraphicsOptions graphics_default_options(void) {
+    return (GraphicsOptions){
+        .present_mode = WGPUPresentMode_Fifo,
+        .max_fps = 0.0,
+        .max_frames_in_flight = 2,
+        .continuous = false,
+    };
+}
+
+static void frame_pacer_init(FramePacer* pacer, const GraphicsOptions* options) {
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->max_frames_in_flight = options->max_frames_in_flight;
+    if (pacer->max_frames_in_flight < 1) {
+        pacer->max_frames_in_flight = 1;
+    }
+    if (pacer->max_frames_in_flight > MAX_FRAMES_IN_FLIGHT_LIMIT) {
+        pacer->max_frames_in_flight = MAX_FRAMES_IN_FLIGHT_LIMIT;
+    }
+    if (options->max_fps > 0.0) {
+        pacer->frame_period_ns = (uint64_t)(SDL_NS_PER_SECOND / options->max_fps);
+    }
+}
+
+// Called before a frame samples input. Sleeps to the frame cap, then
+// waits until at most max_frames_in_flight - 1 frames are still on the
+// GPU, so the new frame never queues behind more than the limit.
+static void frame_pacer_wait(FramePacer* pacer, WGPUDevice device) {
+    if (pacer->frame_period_ns > 0) {
+        uint64_t now = SDL_GetTicksNS();
+        if (now + pacer->frame_period_ns < pacer->next_frame_ns ||
+            now > pacer->next_frame_ns + pacer->frame_period_ns) {
+            // First frame, or too far behind to catch up; restart
+            pacer->next_frame_ns = now;
+        } else if (now < pacer->next_frame_ns) {
+            SDL_DelayNS(pacer->next_frame_ns - now);
+        }
+        pacer->next_frame_ns += pacer->frame_period_ns;
+    }
+
+    if (pacer->submitted >= pacer->max_frames_in_flight) {
+        uint64_t frame = pacer->submitted - pacer->max_frames_in_flight;
+        WGPUSubmissionIndex index =
+            pacer->submissions[frame % MAX_FRAMES_IN_FLIGHT_LIMIT];
+        wgpuDevicePoll(device, true, &index);
+    }
+}
+
+static void frame_pacer_submitted(FramePacer* pacer, WGPUSubmissionIndex index) {
+    pacer->submissions[pacer->submitted % MAX_FRAMES_IN_FLIGHT_LIMIT] = index;
+    pacer->submitted += 1;
+}
+
+static GraphicsEngine* engine_create(
+    const char* title,
+    int width,
+    int height,
+    bool headless,
+    const GraphicsOptions* options
 ) {
     GraphicsEngine* engine = malloc(sizeof(GraphicsEngine));
     if (!engine) {
@@ -554,33 +1608,56 @@ GraphicsEngine* graphics_engine_create(
     }
 
     memset(engine, 0, sizeof(GraphicsEngine));
+    engine->headless = headless;
+    engine->wgpu.present_mode = options->present_mode;
+    engine->continuous = options->continuous;
+    engine->dirty = DIRTY_ALL;
+    frame_pacer_init(&engine->pacer, options);
 
     // Initialize window
-    if (!window_init(&engine->window, title, width, height)) {
+    if (headless) {
+        engine->window.width = width;
+        engine->window.height = height;
+    } else if (!window_init(&engine->window, title, width, height)) {
         free(engine);
         return NULL;
     }
 
     // Initialize WGPU
-    if (!wgpu_init(&engine->wgpu, engine->window.window)) {
-        window_destroy(&engine->window);
+    if (!wgpu_init(&engine->wgpu, headless ? NULL : engine->window.window)) {
+        wgpu_destroy(&engine->wgpu);
+        if (!headless) window_destroy(&engine->window);
         free(engine);
         return NULL;
     }
 
-    // Create swap chain
-    if (!wgpu_configure_surface(&engine->wgpu, width, height)) {
+    // Create swap chain at the window's pixel size
+    width = engine->window.width;
+    height = engine->window.height;
+    if (!headless && !wgpu_configure_surface(&engine->wgpu, width, height)) {
         wgpu_destroy(&engine->wgpu);
         window_destroy(&engine->window);
         free(engine);
         return NULL;
     }
 
-    // Create basic render pipeline
-    if (!create_render_pipeline(engine)) {
-        wgpu_destroy(&engine->wgpu);
-        window_destroy(&engine->window);
-        free(engine);
+    // Create basic render pipeline, its attachments and the upload ring
+    if (!create_render_pipeline(engine) ||
+        !create_render_targets(engine, width, height) ||
+        !upload_ring_init(
+            &engine->upload,
+            engine->wgpu.device,
+            engine->wgpu.queue,
+            UPLOAD_RING_REGION_SIZE
+        )) {
+        graphics_engine_destroy(engine);
+        return NULL;
+    }
+    camera_fit(&engine->camera, NULL, 0);
+    camera_upload(engine);
+
+    if (!frame_arena_init(&engine->frame_arena, FRAME_ARENA_SIZE)) {
+        graphics_engine_destroy(engine);
         return NULL;
     }
 
@@ -589,37 +1666,175 @@ GraphicsEngine* graphics_engine_create(
     return engine;
 }
 
+// `options` may be NULL for graphics_default_options()
+GraphicsEngine* graphics_engine_create(
+    const char* title, int width, int height, const GraphicsOptions* options
+) {
+    GraphicsOptions defaults = graphics_default_options();
+    return engine_create(
+        title, width, height, false, options ? options : &defaults
+    );
+}
+
+// No window or surface; frames are only produced by graphics_engine_capture.
+// Works on software adapters such as lavapipe.
+GraphicsEngine* graphics_engine_create_headless(int width, int height) {
+    GraphicsOptions defaults = graphics_default_options();
+    return engine_create(NULL, width, height, true, &defaults);
+}
+
 void graphics_engine_destroy(GraphicsEngine* engine) {
     if (!engine) return;
 
+    upload_ring_destroy(&engine->upload);
     if(engine->pipeline.vertex_buffer) {
         wgpuBufferRelease(engine->pipeline.vertex_buffer);
     }
+    if (engine->pipeline.instance_buffer) {
+        wgpuBufferRelease(engine->pipeline.instance_buffer);
+    }
+    if (engine->pipeline.bind_group) {
+        wgpuBindGroupRelease(engine->pipeline.bind_group);
+    }
+    if (engine->pipeline.uniform_buffer) {
+        wgpuBufferRelease(engine->pipeline.uniform_buffer);
+    }
     if (engine->pipeline.pipeline) {
         wgpuRenderPipelineRelease(engine->pipeline.pipeline);
     }
 
+    destroy_render_targets(&engine->targets);
+    frame_arena_destroy(&engine->frame_arena);
     wgpu_destroy(&engine->wgpu);
-    window_destroy(&engine->window);
+    if (!engine->headless) window_destroy(&engine->window);
     free(engine);
     log_info("Graphics engine destroyed");
 }
 
-static void render_frame(GraphicsEngine* engine) {
+// Records the pose pass into `color_view`
+static void encode_scene(
+    GraphicsEngine* engine,
+    WGPUCommandEncoder encoder,
+    WGPUTextureView color_view
+) {
+    WGPURenderPassColorAttachment color_attachment = {
+        .view = color_view,
+        .depthSlice = WGPU_DEPTH_SLICE_UNDEFINED,
+        .loadOp = WGPULoadOp_Clear,
+        .storeOp = WGPUStoreOp_Store,
+        .clearValue = {0.1, 0.1, 0.1, 1.0}  // Dark gray background
+    };
+    WGPURenderPassDepthStencilAttachment depth_attachment = {
+        .view = engine->targets.depth_view,
+        .depthLoadOp = WGPULoadOp_Clear,
+        .depthStoreOp = WGPUStoreOp_Discard,
+        .depthClearValue = 1.0f,
+    };
+
+    WGPURenderPassDescriptor render_pass_desc = {
+        .label = {"Main Render Pass", WGPU_STRLEN},
+        .colorAttachmentCount = 1,
+        .colorAttachments = &color_attachment,
+        .depthStencilAttachment = &depth_attachment,
+    };
+
+    WGPURenderPassEncoder pass =
+        wgpuCommandEncoderBeginRenderPass(encoder, &render_pass_desc);
+
+    RenderPipeline* pipeline = &engine->pipeline;
+    if (pipeline->instance_count > 0) {
+        wgpuRenderPassEncoderSetPipeline(pass, pipeline->pipeline);
+        wgpuRenderPassEncoderSetBindGroup(
+            pass, 0, pipeline->bind_group, 0, NULL
+        );
+        wgpuRenderPassEncoderSetVertexBuffer(
+            pass, 0, pipeline->vertex_buffer, 0, WGPU_WHOLE_SIZE
+        );
+        wgpuRenderPassEncoderSetVertexBuffer(
+            pass, 1, pipeline->instance_buffer, 0, WGPU_WHOLE_SIZE
+        );
+
+        // Every pose in one instanced draw
+        wgpuRenderPassEncoderDraw(
+            pass, pipeline->vertex_count, pipeline->instance_count, 0, 0
+        );
+    }
+
+    wgpuRenderPassEncoderEnd(pass);
+    wgpuRenderPassEncoderRelease(pass);
+}
+
+// Applies a pending resize: the surface and every size-dependent target
+// are rebuilt once, however many resize events arrived. False while the
+// window has nothing to render into.
+static bool engine_update_surface(GraphicsEngine* engine) {
+    AppWindow* window = &engine->window;
+    if (window->minimized) {
+        return false;
+    }
+    if (!window->resized) {
+        return true;
+    }
+
+    int width = 0;
+    int height = 0;
+    SDL_GetWindowSizeInPixels(window->window, &width, &height);
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    window->width = width;
+    window->height = height;
+    window->resized = false;
+    if (!wgpu_configure_surface(&engine->wgpu, width, height) ||
+        !create_render_targets(engine, width, height)) {
+        log_error("Failed to resize render targets");
+        window->should_quit = true;
+        return false;
+    }
+    camera_upload(engine);
+    engine->dirty |= DIRTY_WINDOW;
+    return true;
+}
+
+// True once a frame was presented
+static bool render_frame(GraphicsEngine* engine) {
     WGPUSurfaceTexture surface_texture;
     wgpuSurfaceGetCurrentTexture(engine->wgpu.surface, &surface_texture);
 
-    if (surface_texture.status !=
-        WGPUSurfaceGetCurrentTextureStatus_SuccessOptimal) {
-        log_error("Failed to get current surface texture");
-        return;
+    switch (surface_texture.status) {
+        case WGPUSurfaceGetCurrentTextureStatus_SuccessOptimal:
+            break;
+        case WGPUSurfaceGetCurrentTextureStatus_SuccessSuboptimal:
+            // Still presentable; reconfigure before the next frame
+            engine->window.resized = true;
+            break;
+        case WGPUSurfaceGetCurrentTextureStatus_Timeout:
+        case WGPUSurfaceGetCurrentTextureStatus_Outdated:
+        case WGPUSurfaceGetCurrentTextureStatus_Lost:
+            // Skip this frame; Outdated and Lost recover by reconfiguring
+            if (surface_texture.texture) {
+                wgpuTextureRelease(surface_texture.texture);
+            }
+            if (surface_texture.status !=
+                WGPUSurfaceGetCurrentTextureStatus_Timeout) {
+                engine->window.resized = true;
+            }
+            return false;
+        default:
+            log_error("Failed to get current surface texture");
+            if (surface_texture.texture) {
+                wgpuTextureRelease(surface_texture.texture);
+            }
+            engine->window.should_quit = true;
+            return false;
     }
 
     WGPUTextureView back_buffer =
         wgpuTextureCreateView(surface_texture.texture, NULL);
     if (!back_buffer) {
         log_error("Failed to create texture view");
-        return;
+        wgpuTextureRelease(surface_texture.texture);
+        return false;
     }
 
     WGPUCommandEncoderDescriptor cmd_encoder_desc = {
@@ -628,47 +1843,169 @@ static void render_frame(GraphicsEngine* engine) {
     WGPUCommandEncoder encoder =
         wgpuDeviceCreateCommandEncoder(engine->wgpu.device, &cmd_encoder_desc);
 
-    WGPURenderPassColorAttachment color_attachment = {
-        .view = back_buffer,
-        .loadOp = WGPULoadOp_Clear,
-        .storeOp = WGPUStoreOp_Store,
-        .clearValue = {0.1, 0.1, 0.1, 1.0}  // Dark gray background
-    };
+    upload_ring_flush(&engine->upload, encoder);
+    encode_scene(engine, encoder, back_buffer);
 
-    WGPURenderPassDescriptor render_pass_desc = {
-        .label = {"Main Render Pass", WGPU_STRLEN},
-        .colorAttachmentCount = 1,
-        .colorAttachments = &color_attachment
+    WGPUCommandBufferDescriptor cmd_buffer_desc = {
+        .label = {"Command Buffer", WGPU_STRLEN}
     };
+    WGPUCommandBuffer command_buffer =
+        wgpuCommandEncoderFinish(encoder, &cmd_buffer_desc);
+    frame_pacer_submitted(
+        &engine->pacer,
+        wgpuQueueSubmitForIndex(engine->wgpu.queue, 1, &command_buffer)
+    );
+    upload_ring_submitted(&engine->upload);
 
-    WGPURenderPassEncoder pass =
-        wgpuCommandEncoderBeginRenderPass(encoder, &render_pass_desc);
+    wgpuSurfacePresent(engine->wgpu.surface);
 
-    // Set pipeline and vertex buffer
-    wgpuRenderPassEncoderSetPipeline(pass, engine->pipeline.pipeline);
-    wgpuRenderPassEncoderSetVertexBuffer(
-        pass, 0, engine->pipeline.vertex_buffer, 0, WGPU_WHOLE_SIZE
-    );
+    // Clean up
+    wgpuCommandBufferRelease(command_buffer);
+    wgpuCommandEncoderRelease(encoder);
+    wgpuTextureViewRelease(back_buffer);
+    wgpuTextureRelease(surface_texture.texture);
+    return true;
+}
 
-    // Draw using vertex buffer
-    wgpuRenderPassEncoderDraw(pass, 3, 1, 0, 0);  // Draw triangle
+static void readback_callback(
+    WGPUMapAsyncStatus status,
+    WGPUStringView msg,
+    void* userdata1,
+    void* userdata2
+) {
+    if (status != WGPUMapAsyncStatus_Success) {
+        fprintf(
+            stderr, "Failed to map readback buffer: %.*s\n",
+            (int)msg.length, msg.data
+        );
+    }
+    *(WGPUMapAsyncStatus*)userdata1 = status;
+}
 
-    wgpuRenderPassEncoderEnd(pass);
+// Renders one headless frame and writes it to `path` as a binary PPM
+bool graphics_engine_capture(GraphicsEngine* engine, const char* path) {
+    RenderTargets* targets = &engine->targets;
+    if (!engine->headless || !targets->color_texture) {
+        log_error("Capture needs a headless engine");
+        return false;
+    }
+
+    // Copy rows must be 256 byte aligned
+    uint32_t row_size = targets->width * 4;
+    uint32_t row_stride = (row_size + 255) & ~(uint32_t)255;
+    WGPUBufferDescriptor buffer_desc = {
+        .label = {"Readback Buffer", WGPU_STRLEN},
+        .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+        .size = (uint64_t)row_stride * targets->height,
+        .mappedAtCreation = false,
+    };
+    WGPUBuffer readback =
+        wgpuDeviceCreateBuffer(engine->wgpu.device, &buffer_desc);
+    if (!readback) {
+        log_error("Failed to create readback buffer");
+        return false;
+    }
+
+    WGPUCommandEncoderDescriptor cmd_encoder_desc = {
+        .label = {"Capture Encoder", WGPU_STRLEN}
+    };
+    WGPUCommandEncoder encoder =
+        wgpuDeviceCreateCommandEncoder(engine->wgpu.device, &cmd_encoder_desc);
+    upload_ring_flush(&engine->upload, encoder);
+    encode_scene(engine, encoder, targets->color_view);
+
+    WGPUTexelCopyTextureInfo source = {
+        .texture = targets->color_texture,
+        .aspect = WGPUTextureAspect_All,
+    };
+    WGPUTexelCopyBufferInfo destination = {
+        .layout =
+            {
+                .bytesPerRow = row_stride,
+                .rowsPerImage = targets->height,
+            },
+        .buffer = readback,
+    };
+    WGPUExtent3D copy_size = {targets->width, targets->height, 1};
+    wgpuCommandEncoderCopyTextureToBuffer(
+        encoder, &source, &destination, &copy_size
+    );
 
     WGPUCommandBufferDescriptor cmd_buffer_desc = {
-        .label = {"Command Buffer", WGPU_STRLEN}
+        .label = {"Capture Command Buffer", WGPU_STRLEN}
     };
     WGPUCommandBuffer command_buffer =
         wgpuCommandEncoderFinish(encoder, &cmd_buffer_desc);
     wgpuQueueSubmit(engine->wgpu.queue, 1, &command_buffer);
-
-    wgpuSurfacePresent(engine->wgpu.surface);
-
-    // Clean up
+    upload_ring_submitted(&engine->upload);
     wgpuCommandBufferRelease(command_buffer);
-    wgpuRenderPassEncoderRelease(pass);
     wgpuCommandEncoderRelease(encoder);
-    wgpuTextureViewRelease(back_buffer);
+
+    WGPUMapAsyncStatus map_status = 0;
+    WGPUBufferMapCallbackInfo map_cb_info = {
+        .mode = WGPUCallbackMode_AllowSpontaneous,
+        .callback = readback_callback,
+        .userdata1 = &map_status,
+        .userdata2 = NULL,
+    };
+    wgpuBufferMapAsync(
+        readback, WGPUMapMode_Read, 0, buffer_desc.size, map_cb_info
+    );
+    while (!map_status) {
+        wgpuDevicePoll(engine->wgpu.device, true, NULL);
+    }
+    if (map_status != WGPUMapAsyncStatus_Success) {
+        wgpuBufferRelease(readback);
+        return false;
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror("fopen");
+        wgpuBufferUnmap(readback);
+        wgpuBufferRelease(readback);
+        return false;
+    }
+    fprintf(f, "P6\n%u %u\n255\n", targets->width, targets->height);
+
+    // Covered means some channel is well above the background
+    const uint8_t* pixels =
+        wgpuBufferGetConstMappedRange(readback, 0, buffer_desc.size);
+    frame_arena_begin(&engine->frame_arena);
+    uint8_t* row = frame_arena_alloc(
+        &engine->frame_arena, (size_t)targets->width * 3, 1
+    );
+    size_t covered = 0;
+    bool ok = row != NULL;
+    for (uint32_t y = 0; ok && y < targets->height; ++y) {
+        const uint8_t* src = pixels + (size_t)y * row_stride;
+        for (uint32_t x = 0; x < targets->width; ++x) {
+            row[3 * x + 0] = src[4 * x + 0];
+            row[3 * x + 1] = src[4 * x + 1];
+            row[3 * x + 2] = src[4 * x + 2];
+            if (src[4 * x + 0] > 128 || src[4 * x + 1] > 128 ||
+                src[4 * x + 2] > 128) {
+                covered += 1;
+            }
+        }
+        ok = fwrite(row, 3, targets->width, f) == targets->width;
+    }
+    ok = fclose(f) == 0 && ok;
+    wgpuBufferUnmap(readback);
+    wgpuBufferRelease(readback);
+    if (!ok) {
+        log_error("Failed to write capture");
+        return false;
+    }
+
+    printf(
+        "Info: Captured %ux%u frame to %s, %zu pixels covered\n",
+        targets->width,
+        targets->height,
+        path,
+        covered
+    );
+    return true;
 }
 
 void graphics_engine_run(GraphicsEngine* engine) {
@@ -676,11 +2013,57 @@ void graphics_engine_run(GraphicsEngine* engine) {
         log_error("Graphics engine not properly initialized");
         return;
     }
+    if (engine->headless) {
+        log_error("A headless engine has no window to run");
+        return;
+    }
 
     log_info("Starting main loop");
+    size_t idle_waits = 0;
+    uint64_t start_ns = SDL_GetTicksNS();
     while (!engine->window.should_quit) {
+        if (engine->continuous || engine->dirty) {
+            frame_pacer_wait(&engine->pacer, engine->wgpu.device);
+        } else {
+            // Nothing to redraw; sleep until an event arrives
+            SDL_WaitEventTimeout(NULL, IDLE_WAIT_TIMEOUT_MS);
+            idle_waits += 1;
+        }
+        upload_ring_poll(&engine->upload);
         window_handle_events(&engine->window);
-        render_frame(engine);
+        if (engine->window.needs_redraw) {
+            engine->window.needs_redraw = false;
+            engine->dirty |= DIRTY_WINDOW;
+        }
+        if (engine->window.redraw_requested) {
+            engine->window.redraw_requested = false;
+            engine->dirty |= DIRTY_DATA;
+        }
+        if (!engine_update_surface(engine)) {
+            // Minimized or zero-sized; sleep until the window changes
+            SDL_WaitEventTimeout(NULL, IDLE_WAIT_TIMEOUT_MS);
+            continue;
+        }
+        if (engine->frame_callback) {
+            double seconds =
+                (double)(SDL_GetTicksNS() - start_ns) / SDL_NS_PER_SECOND;
+            engine->frame_callback(engine, seconds, engine->frame_userdata);
+        }
+        if (!engine->continuous && !engine->dirty) {
+            continue;
+        }
+        frame_arena_begin(&engine->frame_arena);
+        if (render_frame(engine)) {
+            engine->dirty = 0;
+            engine->frames_presented += 1;
+        }
     }
-    log_info("Main loop ended");
+    // The frame arena also counts attempts whose surface was unavailable
+    printf(
+        "Info: Main loop presented %zu frames in %zu attempts, "
+        "%zu idle waits\n",
+        engine->frames_presented,
+        engine->frame_arena.frame_count,
+        idle_waits
+    );
 }
@@ -0,0 +1,569 @@
+#ifndef SOA_H
+#define SOA_H
+
+#include "alloc.h"
+#include "types.h"
+
+/* 8-wide float lane used to write the batch kernels once per backend */
+#if defined(TYPES_SIMD_AVX2)
+typedef __m256 F32x8;
+
+static inline F32x8 F32x8_Load(const f32* ptr) { return _mm256_load_ps(ptr); }
+static inline void F32x8_Store(f32* ptr, F32x8 a) { _mm256_store_ps(ptr, a); }
+static inline F32x8 F32x8_Set1(f32 value) { return _mm256_set1_ps(value); }
+static inline F32x8 F32x8_Add(F32x8 a, F32x8 b) { return _mm256_add_ps(a, b); }
+static inline F32x8 F32x8_Sub(F32x8 a, F32x8 b) { return _mm256_sub_ps(a, b); }
+static inline F32x8 F32x8_Mul(F32x8 a, F32x8 b) { return _mm256_mul_ps(a, b); }
+static inline F32x8 F32x8_Div(F32x8 a, F32x8 b) { return _mm256_div_ps(a, b); }
+static inline F32x8 F32x8_Sqrt(F32x8 a) { return _mm256_sqrt_ps(a); }
+static inline F32x8 F32x8_Max(F32x8 a, F32x8 b) { return _mm256_max_ps(a, b); }
+static inline F32x8 F32x8_Round(F32x8 a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+static inline F32x8 F32x8_CmpLt(F32x8 a, F32x8 b) {
+    return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+static inline F32x8 F32x8_CmpEq(F32x8 a, F32x8 b) {
+    return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+}
+static inline F32x8 F32x8_And(F32x8 a, F32x8 b) { return _mm256_and_ps(a, b); }
+static inline F32x8 F32x8_Or(F32x8 a, F32x8 b) { return _mm256_or_ps(a, b); }
+/* Lanes of `a` where `mask` is set, lanes of `b` elsewhere */
+static inline F32x8 F32x8_Select(F32x8 mask, F32x8 a, F32x8 b) {
+    return _mm256_blendv_ps(b, a, mask);
+}
+#elif defined(TYPES_SIMD_SSE2)
+typedef struct {
+    __m128 lo;
+    __m128 hi;
+} F32x8;
+
+static inline F32x8 F32x8_Load(const f32* ptr) {
+    return (F32x8){_mm_load_ps(ptr), _mm_load_ps(ptr + 4)};
+}
+static inline void F32x8_Store(f32* ptr, F32x8 a) {
+    _mm_store_ps(ptr, a.lo);
+    _mm_store_ps(ptr + 4, a.hi);
+}
+static inline F32x8 F32x8_Set1(f32 value) {
+    return (F32x8){_mm_set1_ps(value), _mm_set1_ps(value)};
+}
+static inline F32x8 F32x8_Add(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)};
+}
+static inline F32x8 F32x8_Sub(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)};
+}
+static inline F32x8 F32x8_Mul(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)};
+}
+static inline F32x8 F32x8_Div(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)};
+}
+static inline F32x8 F32x8_Sqrt(F32x8 a) {
+    return (F32x8){_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)};
+}
+static inline F32x8 F32x8_Max(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)};
+}
+/* SSE2 has no round instruction; adding 1.5 * 2^23 rounds for |a| < 2^22 */
+static inline F32x8 F32x8_Round(F32x8 a) {
+    __m128 magic = _mm_set1_ps(12582912.0f);
+    return (F32x8){
+        _mm_sub_ps(_mm_add_ps(a.lo, magic), magic),
+        _mm_sub_ps(_mm_add_ps(a.hi, magic), magic),
+    };
+}
+static inline F32x8 F32x8_CmpLt(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi)};
+}
+static inline F32x8 F32x8_CmpEq(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_cmpeq_ps(a.lo, b.lo), _mm_cmpeq_ps(a.hi, b.hi)};
+}
+static inline F32x8 F32x8_And(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi)};
+}
+static inline F32x8 F32x8_Or(F32x8 a, F32x8 b) {
+    return (F32x8){_mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi)};
+}
+/* Lanes of `a` where `mask` is set, lanes of `b` elsewhere */
+static inline F32x8 F32x8_Select(F32x8 mask, F32x8 a, F32x8 b) {
+    return (F32x8){
+        _mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)),
+        _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi)),
+    };
+}
+#else
+typedef struct {
+    f32 v[SOA_LANES];
+} F32x8;
+
+static inline F32x8 F32x8_Load(const f32* ptr) {
+    F32x8 out;
+    memcpy(out.v, ptr, sizeof(out.v));
+    return out;
+}
+static inline void F32x8_Store(f32* ptr, F32x8 a) {
+    memcpy(ptr, a.v, sizeof(a.v));
+}
+static inline F32x8 F32x8_Set1(f32 value) {
+    F32x8 out;
+    for (size_t i = 0; i < SOA_LANES; ++i) out.v[i] = value;
+    return out;
+}
+static inline F32x8 F32x8_Add(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) a.v[i] += b.v[i];
+    return a;
+}
+static inline F32x8 F32x8_Sub(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) a.v[i] -= b.v[i];
+    return a;
+}
+static inline F32x8 F32x8_Mul(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) a.v[i] *= b.v[i];
+    return a;
+}
+static inline F32x8 F32x8_Div(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) a.v[i] /= b.v[i];
+    return a;
+}
+static inline F32x8 F32x8_Sqrt(F32x8 a) {
+    for (size_t i = 0; i < SOA_LANES; ++i) a.v[i] = sqrtf(a.v[i]);
+    return a;
+}
+static inline F32x8 F32x8_Max(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) a.v[i] = fmaxf(a.v[i], b.v[i]);
+    return a;
+}
+static inline F32x8 F32x8_Round(F32x8 a) {
+    for (size_t i = 0; i < SOA_LANES; ++i) a.v[i] = rintf(a.v[i]);
+    return a;
+}
+/* Masks use the same all-ones / all-zeros lane encoding as the SIMD paths */
+static inline f32 F32x8_MaskLane(bool set) {
+    u32 bits = set ? 0xFFFFFFFF : 0;
+    f32 lane;
+    memcpy(&lane, &bits, sizeof(lane));
+    return lane;
+}
+static inline u32 F32x8_LaneBits(f32 lane) {
+    u32 bits;
+    memcpy(&bits, &lane, sizeof(bits));
+    return bits;
+}
+static inline F32x8 F32x8_CmpLt(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) {
+        a.v[i] = F32x8_MaskLane(a.v[i] < b.v[i]);
+    }
+    return a;
+}
+static inline F32x8 F32x8_CmpEq(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) {
+        a.v[i] = F32x8_MaskLane(a.v[i] == b.v[i]);
+    }
+    return a;
+}
+static inline F32x8 F32x8_And(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) {
+        u32 bits = F32x8_LaneBits(a.v[i]) & F32x8_LaneBits(b.v[i]);
+        memcpy(&a.v[i], &bits, sizeof(bits));
+    }
+    return a;
+}
+static inline F32x8 F32x8_Or(F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) {
+        u32 bits = F32x8_LaneBits(a.v[i]) | F32x8_LaneBits(b.v[i]);
+        memcpy(&a.v[i], &bits, sizeof(bits));
+    }
+    return a;
+}
+/* Lanes of `a` where `mask` is set, lanes of `b` elsewhere */
+static inline F32x8 F32x8_Select(F32x8 mask, F32x8 a, F32x8 b) {
+    for (size_t i = 0; i < SOA_LANES; ++i) {
+        if (F32x8_LaneBits(mask.v[i]) == 0) a.v[i] = b.v[i];
+    }
+    return a;
+}
+#endif
+
+/*
+ * sin and cos of every lane.  Cody-Waite reduction to [-pi/4, pi/4] around
+ * the nearest multiple of pi/2, then the Cephes single precision
+ * polynomials; accurate to a few ulp for |x| < 2^22.
+ */
+static inline void F32x8_SinCos(F32x8 x, F32x8* sin_out, F32x8* cos_out) {
+    F32x8 quadrant = F32x8_Round(F32x8_Mul(x, F32x8_Set1(0.63661977236f)));
+    F32x8 y = F32x8_Sub(x, F32x8_Mul(quadrant, F32x8_Set1(1.5703125f)));
+    y = F32x8_Sub(y, F32x8_Mul(quadrant, F32x8_Set1(4.837512969970703125e-4f)));
+    y = F32x8_Sub(y, F32x8_Mul(quadrant, F32x8_Set1(7.54978995489188216e-8f)));
+    // quadrant mod 4, computed in float so no integer lanes are needed
+    F32x8 wraps = F32x8_Round(F32x8_Sub(
+        F32x8_Mul(quadrant, F32x8_Set1(0.25f)), F32x8_Set1(0.375f)
+    ));
+    F32x8 q = F32x8_Sub(quadrant, F32x8_Mul(wraps, F32x8_Set1(4.0f)));
+
+    F32x8 z = F32x8_Mul(y, y);
+    F32x8 poly_sin = F32x8_Add(
+        F32x8_Mul(F32x8_Set1(-1.9515295891e-4f), z), F32x8_Set1(8.3321608736e-3f)
+    );
+    poly_sin = F32x8_Sub(F32x8_Mul(poly_sin, z), F32x8_Set1(1.6666654611e-1f));
+    poly_sin = F32x8_Add(y, F32x8_Mul(F32x8_Mul(poly_sin, z), y));
+    F32x8 poly_cos = F32x8_Sub(
+        F32x8_Mul(F32x8_Set1(2.443315711809948e-5f), z),
+        F32x8_Set1(1.388731625493765e-3f)
+    );
+    poly_cos = F32x8_Add(
+        F32x8_Mul(poly_cos, z), F32x8_Set1(4.166664568298827e-2f)
+    );
+    poly_cos = F32x8_Add(
+        F32x8_Sub(F32x8_Set1(1.0f), F32x8_Mul(F32x8_Set1(0.5f), z)),
+        F32x8_Mul(F32x8_Mul(z, z), poly_cos)
+    );
+
+    F32x8 zero = F32x8_Set1(0.0f);
+    F32x8 swap = F32x8_Or(
+        F32x8_CmpEq(q, F32x8_Set1(1.0f)), F32x8_CmpEq(q, F32x8_Set1(3.0f))
+    );
+    F32x8 sin_neg = F32x8_CmpLt(F32x8_Set1(1.5f), q);
+    F32x8 cos_neg = F32x8_And(
+        F32x8_CmpLt(F32x8_Set1(0.5f), q), F32x8_CmpLt(q, F32x8_Set1(2.5f))
+    );
+    F32x8 sin_v = F32x8_Select(swap, poly_cos, poly_sin);
+    F32x8 cos_v = F32x8_Select(swap, poly_sin, poly_cos);
+    *sin_out = F32x8_Select(sin_neg, F32x8_Sub(zero, sin_v), sin_v);
+    *cos_out = F32x8_Select(cos_neg, F32x8_Sub(zero, cos_v), cos_v);
+}
+
+size_t SoA_PaddedCount(size_t count);
+
+RETURN_STATUS Vec3SoA_Init(Vec3SoA* soa, Stack* arena, size_t capacity);
+void Vec3SoA_Set(Vec3SoA* soa, size_t index, Vec3 vec);
+Vec3 Vec3SoA_Get(const Vec3SoA* soa, size_t index);
+void Vec3SoA_Rotate(const Vec3SoA* vecs, Mat3 rot, Vec3SoA* out);
+void Vec3SoA_Add(const Vec3SoA* a, const Vec3SoA* b, Vec3SoA* out);
+void Vec3SoA_Dot(const Vec3SoA* a, const Vec3SoA* b, f32* out);
+void Vec3SoA_Cross(const Vec3SoA* a, const Vec3SoA* b, Vec3SoA* out);
+void Vec3SoA_Normalize(const Vec3SoA* vecs, Vec3SoA* out);
+void Vec3SoA_Project(const Vec3SoA* src, const Vec3SoA* dst, Vec3SoA* out);
+
+void Vec3SoA_RotVecToMat3(const Vec3SoA* rvecs, Mat3* out);
+void Vec3SoA_RotVecToQuat(const Vec3SoA* rvecs, Quat* out);
+
+RETURN_STATUS PoseSoA_Init(PoseSoA* poses, Stack* arena, size_t capacity);
+void PoseSoA_Set(PoseSoA* poses, size_t index, Pose pose);
+Pose PoseSoA_Get(const PoseSoA* poses, size_t index);
+void PoseSoA_ToMat4(const PoseSoA* poses, Mat4* out);
+
+size_t SoA_PaddedCount(size_t count) {
+    return (count + SOA_LANES - 1) & ~(size_t)(SOA_LANES - 1);
+}
+
+RETURN_STATUS Vec3SoA_Init(Vec3SoA* soa, Stack* arena, size_t capacity) {
+    size_t padded = SoA_PaddedCount(capacity);
+    soa->x = (f32*)Stack_AllocAlign(arena, padded * sizeof(f32), SOA_ALIGNMENT);
+    soa->y = (f32*)Stack_AllocAlign(arena, padded * sizeof(f32), SOA_ALIGNMENT);
+    soa->z = (f32*)Stack_AllocAlign(arena, padded * sizeof(f32), SOA_ALIGNMENT);
+    if (soa->x == NULL || soa->y == NULL || soa->z == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate Vec3SoA\n");
+        return FAILURE;
+    }
+    soa->size = capacity;
+    soa->capacity = padded;
+    return SUCCESS;
+}
+
+void Vec3SoA_Set(Vec3SoA* soa, size_t index, Vec3 vec) {
+    soa->x[index] = vec.x;
+    soa->y[index] = vec.y;
+    soa->z[index] = vec.z;
+}
+
+Vec3 Vec3SoA_Get(const Vec3SoA* soa, size_t index) {
+    return (Vec3){soa->x[index], soa->y[index], soa->z[index]};
+}
+
+void Vec3SoA_Rotate(const Vec3SoA* vecs, Mat3 rot, Vec3SoA* out) {
+    F32x8 r00 = F32x8_Set1(rot.x_row.x);
+    F32x8 r01 = F32x8_Set1(rot.x_row.y);
+    F32x8 r02 = F32x8_Set1(rot.x_row.z);
+    F32x8 r10 = F32x8_Set1(rot.y_row.x);
+    F32x8 r11 = F32x8_Set1(rot.y_row.y);
+    F32x8 r12 = F32x8_Set1(rot.y_row.z);
+    F32x8 r20 = F32x8_Set1(rot.z_row.x);
+    F32x8 r21 = F32x8_Set1(rot.z_row.y);
+    F32x8 r22 = F32x8_Set1(rot.z_row.z);
+    for (size_t i = 0; i < vecs->size; i += SOA_LANES) {
+        F32x8 x = F32x8_Load(&vecs->x[i]);
+        F32x8 y = F32x8_Load(&vecs->y[i]);
+        F32x8 z = F32x8_Load(&vecs->z[i]);
+        F32x8 rx = F32x8_Add(
+            F32x8_Add(F32x8_Mul(r00, x), F32x8_Mul(r01, y)), F32x8_Mul(r02, z)
+        );
+        F32x8 ry = F32x8_Add(
+            F32x8_Add(F32x8_Mul(r10, x), F32x8_Mul(r11, y)), F32x8_Mul(r12, z)
+        );
+        F32x8 rz = F32x8_Add(
+            F32x8_Add(F32x8_Mul(r20, x), F32x8_Mul(r21, y)), F32x8_Mul(r22, z)
+        );
+        F32x8_Store(&out->x[i], rx);
+        F32x8_Store(&out->y[i], ry);
+        F32x8_Store(&out->z[i], rz);
+    }
+    out->size = vecs->size;
+}
+
+void Vec3SoA_Add(const Vec3SoA* a, const Vec3SoA* b, Vec3SoA* out) {
+    for (size_t i = 0; i < a->size; i += SOA_LANES) {
+        F32x8_Store(
+            &out->x[i], F32x8_Add(F32x8_Load(&a->x[i]), F32x8_Load(&b->x[i]))
+        );
+        F32x8_Store(
+            &out->y[i], F32x8_Add(F32x8_Load(&a->y[i]), F32x8_Load(&b->y[i]))
+        );
+        F32x8_Store(
+            &out->z[i], F32x8_Add(F32x8_Load(&a->z[i]), F32x8_Load(&b->z[i]))
+        );
+    }
+    out->size = a->size;
+}
+
+/* `out` must hold SoA_PaddedCount(a->size) floats and be 32-byte aligned */
+void Vec3SoA_Dot(const Vec3SoA* a, const Vec3SoA* b, f32* out) {
+    for (size_t i = 0; i < a->size; i += SOA_LANES) {
+        F32x8 dot = F32x8_Add(
+            F32x8_Add(
+                F32x8_Mul(F32x8_Load(&a->x[i]), F32x8_Load(&b->x[i])),
+                F32x8_Mul(F32x8_Load(&a->y[i]), F32x8_Load(&b->y[i]))
+            ),
+            F32x8_Mul(F32x8_Load(&a->z[i]), F32x8_Load(&b->z[i]))
+        );
+        F32x8_Store(&out[i], dot);
+    }
+}
+
+void Vec3SoA_Cross(const Vec3SoA* a, const Vec3SoA* b, Vec3SoA* out) {
+    for (size_t i = 0; i < a->size; i += SOA_LANES) {
+        F32x8 ax = F32x8_Load(&a->x[i]);
+        F32x8 ay = F32x8_Load(&a->y[i]);
+        F32x8 az = F32x8_Load(&a->z[i]);
+        F32x8 bx = F32x8_Load(&b->x[i]);
+        F32x8 by = F32x8_Load(&b->y[i]);
+        F32x8 bz = F32x8_Load(&b->z[i]);
+        F32x8_Store(
+            &out->x[i], F32x8_Sub(F32x8_Mul(ay, bz), F32x8_Mul(az, by))
+        );
+        F32x8_Store(
+            &out->y[i], F32x8_Sub(F32x8_Mul(az, bx), F32x8_Mul(ax, bz))
+        );
+        F32x8_Store(
+            &out->z[i], F32x8_Sub(F32x8_Mul(ax, by), F32x8_Mul(ay, bx))
+        );
+    }
+    out->size = a->size;
+}
+
+void Vec3SoA_Normalize(const Vec3SoA* vecs, Vec3SoA* out) {
+    F32x8 one = F32x8_Set1(1.0f);
+    for (size_t i = 0; i < vecs->size; i += SOA_LANES) {
+        F32x8 x = F32x8_Load(&vecs->x[i]);
+        F32x8 y = F32x8_Load(&vecs->y[i]);
+        F32x8 z = F32x8_Load(&vecs->z[i]);
+        F32x8 mag_sq = F32x8_Add(
+            F32x8_Add(F32x8_Mul(x, x), F32x8_Mul(y, y)), F32x8_Mul(z, z)
+        );
+        F32x8 inv_mag = F32x8_Div(one, F32x8_Sqrt(mag_sq));
+        F32x8_Store(&out->x[i], F32x8_Mul(x, inv_mag));
+        F32x8_Store(&out->y[i], F32x8_Mul(y, inv_mag));
+        F32x8_Store(&out->z[i], F32x8_Mul(z, inv_mag));
+    }
+    out->size = vecs->size;
+}
+
+void Vec3SoA_Project(const Vec3SoA* src, const Vec3SoA* dst, Vec3SoA* out) {
+    for (size_t i = 0; i < src->size; i += SOA_LANES) {
+        F32x8 sx = F32x8_Load(&src->x[i]);
+        F32x8 sy = F32x8_Load(&src->y[i]);
+        F32x8 sz = F32x8_Load(&src->z[i]);
+        F32x8 dx = F32x8_Load(&dst->x[i]);
+        F32x8 dy = F32x8_Load(&dst->y[i]);
+        F32x8 dz = F32x8_Load(&dst->z[i]);
+        F32x8 src_dot_dst = F32x8_Add(
+            F32x8_Add(F32x8_Mul(sx, dx), F32x8_Mul(sy, dy)), F32x8_Mul(sz, dz)
+        );
+        F32x8 dst_mag_sq = F32x8_Add(
+            F32x8_Add(F32x8_Mul(dx, dx), F32x8_Mul(dy, dy)), F32x8_Mul(dz, dz)
+        );
+        F32x8 scale = F32x8_Div(src_dot_dst, dst_mag_sq);
+        F32x8_Store(&out->x[i], F32x8_Mul(dx, scale));
+        F32x8_Store(&out->y[i], F32x8_Mul(dy, scale));
+        F32x8_Store(&out->z[i], F32x8_Mul(dz, scale));
+    }
+    out->size = src->size;
+}
+
+/*
+ * Row-major rotation entries for 8 rotation vectors at once; the same
+ * half-angle formulation as Mat3_FromRotVec with one sincos per lane.
+ */
+static inline void SoA_RodriguesLanes(
+    F32x8 x, F32x8 y, F32x8 z, F32x8 rot[9]
+) {
+    F32x8 theta = F32x8_Sqrt(F32x8_Add(
+        F32x8_Add(F32x8_Mul(x, x), F32x8_Mul(y, y)), F32x8_Mul(z, z)
+    ));
+    theta = F32x8_Max(theta, F32x8_Set1(1e-12f));
+    F32x8 half_sin;
+    F32x8 half_cos;
+    F32x8_SinCos(F32x8_Mul(theta, F32x8_Set1(0.5f)), &half_sin, &half_cos);
+    F32x8 two_sin_sq = F32x8_Mul(F32x8_Set1(2.0f), F32x8_Mul(half_sin, half_sin));
+    F32x8 cos_t = F32x8_Sub(F32x8_Set1(1.0f), two_sin_sq);
+    F32x8 a = F32x8_Div(
+        F32x8_Mul(F32x8_Set1(2.0f), F32x8_Mul(half_sin, half_cos)), theta
+    );
+    F32x8 b = F32x8_Div(two_sin_sq, F32x8_Mul(theta, theta));
+
+    F32x8 bxy = F32x8_Mul(b, F32x8_Mul(x, y));
+    F32x8 bxz = F32x8_Mul(b, F32x8_Mul(x, z));
+    F32x8 byz = F32x8_Mul(b, F32x8_Mul(y, z));
+    F32x8 ax = F32x8_Mul(a, x);
+    F32x8 ay = F32x8_Mul(a, y);
+    F32x8 az = F32x8_Mul(a, z);
+    rot[0] = F32x8_Add(cos_t, F32x8_Mul(b, F32x8_Mul(x, x)));
+    rot[1] = F32x8_Sub(bxy, az);
+    rot[2] = F32x8_Add(bxz, ay);
+    rot[3] = F32x8_Add(bxy, az);
+    rot[4] = F32x8_Add(cos_t, F32x8_Mul(b, F32x8_Mul(y, y)));
+    rot[5] = F32x8_Sub(byz, ax);
+    rot[6] = F32x8_Sub(bxz, ay);
+    rot[7] = F32x8_Add(byz, ax);
+    rot[8] = F32x8_Add(cos_t, F32x8_Mul(b, F32x8_Mul(z, z)));
+}
+
+/* `out` must hold rvecs->size matrices */
+void Vec3SoA_RotVecToMat3(const Vec3SoA* rvecs, Mat3* out) {
+    F32x8 rot[9];
+    const f32* lanes = (const f32*)rot;
+    for (size_t i = 0; i < rvecs->size; i += SOA_LANES) {
+        SoA_RodriguesLanes(
+            F32x8_Load(&rvecs->x[i]),
+            F32x8_Load(&rvecs->y[i]),
+            F32x8_Load(&rvecs->z[i]),
+            rot
+        );
+        size_t n_lanes = rvecs->size - i < SOA_LANES ? rvecs->size - i
+                                                      : SOA_LANES;
+        for (size_t lane = 0; lane < n_lanes; ++lane) {
+            f32* dst = (f32*)&out[i + lane];
+            for (size_t k = 0; k < 9; ++k) {
+                dst[k] = lanes[k * SOA_LANES + lane];
+            }
+        }
+    }
+}
+
+/* `out` must hold rvecs->size quaternions */
+void Vec3SoA_RotVecToQuat(const Vec3SoA* rvecs, Quat* out) {
+    F32x8 quat[4];
+    const f32* lanes = (const f32*)quat;
+    for (size_t i = 0; i < rvecs->size; i += SOA_LANES) {
+        F32x8 x = F32x8_Load(&rvecs->x[i]);
+        F32x8 y = F32x8_Load(&rvecs->y[i]);
+        F32x8 z = F32x8_Load(&rvecs->z[i]);
+        F32x8 theta = F32x8_Sqrt(F32x8_Add(
+            F32x8_Add(F32x8_Mul(x, x), F32x8_Mul(y, y)), F32x8_Mul(z, z)
+        ));
+        theta = F32x8_Max(theta, F32x8_Set1(1e-12f));
+        F32x8 half_sin;
+        F32x8_SinCos(F32x8_Mul(theta, F32x8_Set1(0.5f)), &half_sin, &quat[3]);
+        F32x8 scale = F32x8_Div(half_sin, theta);
+        quat[0] = F32x8_Mul(scale, x);
+        quat[1] = F32x8_Mul(scale, y);
+        quat[2] = F32x8_Mul(scale, z);
+
+        size_t n_lanes = rvecs->size - i < SOA_LANES ? rvecs->size - i
+                                                      : SOA_LANES;
+        for (size_t lane = 0; lane < n_lanes; ++lane) {
+            out[i + lane] = (Quat){
+                lanes[0 * SOA_LANES + lane],
+                lanes[1 * SOA_LANES + lane],
+                lanes[2 * SOA_LANES + lane],
+                lanes[3 * SOA_LANES + lane],
+            };
+        }
+    }
+}
+
+RETURN_STATUS PoseSoA_Init(PoseSoA* poses, Stack* arena, size_t capacity) {
+    size_t padded = SoA_PaddedCount(capacity);
+    poses->id =
+        (u32*)Stack_AllocAlign(arena, padded * sizeof(u32), SOA_ALIGNMENT);
+    poses->replicate_id =
+        (u32*)Stack_AllocAlign(arena, padded * sizeof(u32), SOA_ALIGNMENT);
+    if (poses->id == NULL || poses->replicate_id == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate PoseSoA\n");
+        return FAILURE;
+    }
+    if (Vec3SoA_Init(&poses->rvec, arena, capacity) != SUCCESS) {
+        return FAILURE;
+    }
+    if (Vec3SoA_Init(&poses->tvec, arena, capacity) != SUCCESS) {
+        return FAILURE;
+    }
+    poses->size = capacity;
+    return SUCCESS;
+}
+
+void PoseSoA_Set(PoseSoA* poses, size_t index, Pose pose) {
+    poses->id[index] = pose.id;
+    poses->replicate_id[index] = pose.replicate_id;
+    Vec3SoA_Set(&poses->rvec, index, pose.rvec);
+    Vec3SoA_Set(&poses->tvec, index, pose.tvec);
+}
+
+Pose PoseSoA_Get(const PoseSoA* poses, size_t index) {
+    return (Pose){
+        .id = poses->id[index],
+        .replicate_id = poses->replicate_id[index],
+        .rvec = Vec3SoA_Get(&poses->rvec, index),
+        .tvec = Vec3SoA_Get(&poses->tvec, index),
+    };
+}
+
+/* Model matrix of every pose; `out` must hold poses->size matrices */
+void PoseSoA_ToMat4(const PoseSoA* poses, Mat4* out) {
+    F32x8 rot[9];
+    const f32* lanes = (const f32*)rot;
+    for (size_t i = 0; i < poses->size; i += SOA_LANES) {
+        SoA_RodriguesLanes(
+            F32x8_Load(&poses->rvec.x[i]),
+            F32x8_Load(&poses->rvec.y[i]),
+            F32x8_Load(&poses->rvec.z[i]),
+            rot
+        );
+        size_t n_lanes = poses->size - i < SOA_LANES ? poses->size - i
+                                                      : SOA_LANES;
+        for (size_t lane = 0; lane < n_lanes; ++lane) {
+            size_t index = i + lane;
+            out[index] = (Mat4){
+                .x_row =
+                    {lanes[0 * SOA_LANES + lane],
+                     lanes[1 * SOA_LANES + lane],
+                     lanes[2 * SOA_LANES + lane],
+                     poses->tvec.x[index]},
+                .y_row =
+                    {lanes[3 * SOA_LANES + lane],
+                     lanes[4 * SOA_LANES + lane],
+                     lanes[5 * SOA_LANES + lane],
+                     poses->tvec.y[index]},
+                .z_row =
+                    {lanes[6 * SOA_LANES + lane],
+                     lanes[7 * SOA_LANES + lane],
+                     lanes[8 * SOA_LANES + lane],
+                     poses->tvec.z[index]},
+                .w_row = {0.0f, 0.0f, 0.0f, 1.0f},
+            };
+        }
+    }
+}
+
+#endif /* SOA_H */
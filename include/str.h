@@ -0,0 +1,97 @@
+#ifndef STR_H
+#define STR_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "base.h"
+
+typedef struct String String;
+typedef struct StringView StringView;
+
+/*
+ * A growable, non-null terminated byte string.  Up to
+ * STRING_INLINE_CAPACITY bytes live inside the struct itself, so short
+ * strings (tokens, numbers, single lines) never touch the heap.  Storage is
+ * inline while `capacity` is at most STRING_INLINE_CAPACITY, which also
+ * makes a zeroed String a valid empty one; there is no pointer into the
+ * struct, so a String can be copied or moved with memcpy.  Always go
+ * through String_Data rather than `data` directly.
+ */
+#define STRING_INLINE_CAPACITY 16
+#define STRING_MIN_HEAP_CAPACITY 64
+
+struct String {
+    size_t size;
+    size_t capacity;
+    union {
+        char* heap;
+        char inline_items[STRING_INLINE_CAPACITY];
+    } data;
+};
+
+/* A non-owning slice of a larger buffer */
+struct StringView {
+    char* start;
+    size_t length;
+};
+
+static inline bool String_IsInline(const String* str) {
+    return str->capacity <= STRING_INLINE_CAPACITY;
+}
+
+static inline char* String_Data(String* str) {
+    return String_IsInline(str) ? str->data.inline_items : str->data.heap;
+}
+
+static inline StringView String_View(String* str) {
+    return (StringView){.start = String_Data(str), .length = str->size};
+}
+
+RETURN_STATUS String_Reserve(String* str, size_t capacity);
+RETURN_STATUS String_Append(String* str, const char* data, size_t len);
+RETURN_STATUS String_AppendStr(String* str, const char* input_str);
+RETURN_STATUS String_AppendChar(String* str, char c);
+/* Appends every argument up to a terminating NULL */
+RETURN_STATUS String_AppendMany(String* str, ...);
+RETURN_STATUS String_AppendU64(String* str, u64 value);
+RETURN_STATUS String_AppendF32(String* str, f32 value);
+RETURN_STATUS String_AppendVec3(String* str, Vec3 vec);
+RETURN_STATUS String_AppendVec4(String* str, Vec4 vec);
+RETURN_STATUS String_AppendMat4(String* str, Mat4 mat);
+/* One pose as a CSV line that Poses_ParseCSV reads back exactly */
+RETURN_STATUS String_AppendPose(String* str, Pose pose);
+/* Hands the contents over as a malloc'd buffer and leaves `str` empty */
+char* String_Detach(String* str);
+void String_Reset(String* str);
+bool String_IsEmpty(const String* str);
+void String_Free(String* str);
+
+/*
+ * Shortest decimal that parses back to exactly `value` (Ryu), written
+ * without a terminator.  Plain notation is used for magnitudes from 1e-5
+ * up to 1e9, scientific otherwise.  Returns the number of chars written.
+ */
+#define F32_FORMAT_MAX 16
+size_t F32_Format(f32 value, char* out);
+
+#ifdef ALLOC_TRACE
+#define String_Reserve(...) ALLOC_TRACE_CALL(String_Reserve, __VA_ARGS__)
+// Appends grow through String_Reserve, so they name the site themselves
+#define String_Append(...) ALLOC_TRACE_CALL(String_Append, __VA_ARGS__)
+#define String_AppendStr(...) ALLOC_TRACE_CALL(String_AppendStr, __VA_ARGS__)
+#define String_AppendChar(...) ALLOC_TRACE_CALL(String_AppendChar, __VA_ARGS__)
+#define String_AppendMany(...) ALLOC_TRACE_CALL(String_AppendMany, __VA_ARGS__)
+#define String_AppendU64(...) ALLOC_TRACE_CALL(String_AppendU64, __VA_ARGS__)
+#define String_AppendF32(...) ALLOC_TRACE_CALL(String_AppendF32, __VA_ARGS__)
+#define String_AppendVec3(...) ALLOC_TRACE_CALL(String_AppendVec3, __VA_ARGS__)
+#define String_AppendVec4(...) ALLOC_TRACE_CALL(String_AppendVec4, __VA_ARGS__)
+#define String_AppendMat4(...) ALLOC_TRACE_CALL(String_AppendMat4, __VA_ARGS__)
+#define String_AppendPose(...) ALLOC_TRACE_CALL(String_AppendPose, __VA_ARGS__)
+#define String_Detach(...) ALLOC_TRACE_CALL(String_Detach, __VA_ARGS__)
+#endif /* ALLOC_TRACE */
+
+#endif /* STR_H */
@@ -2,14 +2,198 @@
 #define TESTS_H
 
 #include <assert.h>
+#include <sys/stat.h>
 
+#include "csv.h"
+#include "soa.h"
 #include "types.h"
 
 #define TEST_F32_ERR 1e-7
+#define TEST_ROT_ERR 1e-5
+#define TEST_CSV_PATH "test_poses.csv"
+#define TEST_CACHE_PATH TEST_CSV_PATH ".posecache"
+
+static bool Test_Mat3IsClose(Mat3 a, Mat3 b, f32 tolerance) {
+    const f32* ptr_a = (const f32*)&a;
+    const f32* ptr_b = (const f32*)&b;
+    for (size_t i = 0; i < 9; ++i) {
+        if (F32_Abs(ptr_a[i] - ptr_b[i]) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static StringView Test_View(const char* text) {
+    return (StringView){.start = (char*)text, .length = strlen(text)};
+}
+
+/* Byte-at-a-time split with the same rules as StringView_ScanSpans */
+static size_t Test_ReferenceSpans(
+    const char* buf, size_t len, char delim_a, char delim_b, Span* spans
+) {
+    size_t n_spans = 0;
+    size_t piece_start = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (buf[i] == delim_a || buf[i] == delim_b) {
+            spans[n_spans++] = (Span){piece_start, i - piece_start};
+            piece_start = i + 1;
+        }
+    }
+    if (piece_start < len) {
+        spans[n_spans++] = (Span){piece_start, len - piece_start};
+    }
+    return n_spans;
+}
+
+/* Scan `len` bytes in batches of at most `batch` spans and check each one */
+static void Test_CheckScan(
+    const char* buf, size_t len, char delim_a, char delim_b, size_t batch
+) {
+    Span expected[160];
+    Span found[160];
+    size_t n_expected =
+        Test_ReferenceSpans(buf, len, delim_a, delim_b, expected);
+    size_t n_found = 0;
+    StringView rest = {.start = (char*)buf, .length = len};
+    do {
+        size_t consumed = 0;
+        size_t n_spans = delim_a == delim_b
+                             ? StringView_ScanSpans(
+                                   rest, delim_a, &found[n_found], batch,
+                                   &consumed
+                               )
+                             : StringView_ScanFields(
+                                   rest, delim_a, delim_b, &found[n_found],
+                                   batch, &consumed
+                               );
+        assert(n_spans <= batch);
+        size_t base = (size_t)(rest.start - buf);
+        for (size_t i = 0; i < n_spans; ++i) {
+            found[n_found + i].offset += base;
+        }
+        n_found += n_spans;
+        rest.start += consumed;
+        rest.length -= consumed;
+    } while (rest.length > 0);
+    assert(n_found == n_expected);
+    for (size_t i = 0; i < n_found; ++i) {
+        assert(found[i].offset == expected[i].offset);
+        assert(found[i].length == expected[i].length);
+    }
+}
+
+/* Overwrite `size` bytes at `offset` of an existing file */
+static void Test_PatchFile(
+    const char* filepath, long offset, const void* bytes, size_t size
+) {
+    FILE* file = fopen(filepath, "r+b");
+    assert(file != NULL);
+    assert(fseek(file, offset, SEEK_SET) == 0);
+    assert(fwrite(bytes, 1, size, file) == size);
+    assert(fclose(file) == 0);
+}
+
+static void Test_CheckPoseCache(
+    const PoseCache* cache, const Pose* poses, size_t count
+) {
+    const PoseSoA* soa = &cache->poses;
+    assert(soa->size == count && soa->rvec.size == count);
+    assert(soa->rvec.capacity % 16 == 0 && soa->rvec.capacity >= count);
+    for (size_t i = 0; i < count; ++i) {
+        assert(soa->id[i] == poses[i].id);
+        assert(soa->replicate_id[i] == poses[i].replicate_id);
+        assert(soa->rvec.x[i] == poses[i].rvec.x);
+        assert(soa->rvec.y[i] == poses[i].rvec.y);
+        assert(soa->rvec.z[i] == poses[i].rvec.z);
+        assert(soa->tvec.x[i] == poses[i].tvec.x);
+        assert(soa->tvec.y[i] == poses[i].tvec.y);
+        assert(soa->tvec.z[i] == poses[i].tvec.z);
+    }
+    // Padding lanes are zero
+    for (size_t i = count; i < soa->rvec.capacity; ++i) {
+        assert(soa->id[i] == 0 && soa->tvec.z[i] == 0.0f);
+    }
+}
+
+/* String_SplitIndex must find exactly the pieces String_Split copies */
+static void Test_CheckSplitIndex(String* str, char delim, LineIndex* index) {
+    VecString pieces = {0};
+    assert(String_Split(str, &pieces, delim) == EXIT_OK);
+    assert(String_SplitIndex(str, index, delim) == EXIT_OK);
+    assert(index->size == pieces.size);
+    assert(LineIndex_IsEmpty(index) == (pieces.size == 0));
+    for (size_t i = 0; i < pieces.size; ++i) {
+        StringView line = LineIndex_Get(index, i);
+        assert(line.start >= String_Data(str));
+        assert(line.length == pieces.items[i].size);
+        assert(memcmp(line.start, String_Data(&pieces.items[i]),
+                      line.length) == 0);
+    }
+    VecString_Free(&pieces);
+}
+
+static void Test_WriteFile(const char* filepath, const char* text) {
+    FILE* file = fopen(filepath, "wb");
+    assert(file != NULL);
+    assert(fwrite(text, 1, strlen(text), file) == strlen(text));
+    assert(fclose(file) == 0);
+}
+
+#ifdef ALLOC_TRACE
+// Calls recorded for `allocator` at `file`:`line` in the current report
+static size_t Test_TraceCount(const char* allocator, const char* file, int line) {
+    FILE* out = tmpfile();
+    assert(out != NULL);
+    AllocTrace_Report(out);
+    rewind(out);
+    char site[256];
+    snprintf(site, sizeof(site), "%s:%d", file, line);
+    size_t found = 0;
+    char row[512];
+    while (fgets(row, sizeof(row), out) != NULL) {
+        size_t bytes, count, largest, copied;
+        char name[64], where[256];
+        if (sscanf(row, "%zu %zu %zu %zu %63s %255s", &bytes, &count,
+                   &largest, &copied, name, where) == 6 &&
+            strcmp(name, allocator) == 0 && strcmp(where, site) == 0) {
+            found += count;
+        }
+    }
+    fclose(out);
+    return found;
+}
+#endif /* ALLOC_TRACE */
 
 static void Test_Vec4IsEqual(void);
+static void Test_Vec4DotNormalize(void);
 static void Test_Mat4IsEqual(void);
 static void Test_Mat4Transpose(void);
+static void Test_Mat4Mul(void);
+static void Test_Mat4Inverse(void);
+static void Test_Mat4MulBatch(void);
+static void Test_Vec3SoAKernels(void);
+static void Test_RotVec(void);
+static void Test_RotVecBatch(void);
+static void Test_Quat(void);
+static void Test_QuatResample(void);
+static void Test_ArenaGrowth(void);
+static void Test_VirtualStack(void);
+static void Test_Pool(void);
+static void Test_StackFlags(void);
+static void Test_Scratch(void);
+static void Test_StringBuilder(void);
+static void Test_F32Format(void);
+static void Test_ScanSpans(void);
+static void Test_PosesParseCSV(void);
+static void Test_PosesParseParallel(void);
+static void Test_ParseNumbers(void);
+static void Test_PoseRoundTrip(void);
+static void Test_PoseCache(void);
+static void Test_LineIndex(void);
+#ifdef ALLOC_TRACE
+static void Test_AllocTrace(void);
+#endif /* ALLOC_TRACE */
 
 void Test_Vec4IsEqual(void) {
     Vec4 vec = {0.0, 1.0, 2.0, 3.0};
@@ -20,6 +204,18 @@ void Test_Vec4IsEqual(void) {
     assert(!Vec4_IsEqual(vec, vecNotEq));
 }
 
+void Test_Vec4DotNormalize(void) {
+    Vec4 vec = {1.0, 2.0, 2.0, 4.0};
+    Vec4 other = {4.0, 3.0, 2.0, 1.0};
+    Vec4 unit = {0.2, 0.4, 0.4, 0.8};
+
+    assert(Vec4_Dot(vec, other) == 18.0f);
+    assert(Vec4_Mag(vec) == 5.0f);
+    assert(Vec4_IsEqual(Vec4_Scale(vec, 0.5f), (Vec4){0.5, 1.0, 1.0, 2.0}));
+    assert(F32_Abs(Vec4_Mag(Vec4_Normalize(vec)) - 1.0f) < 1e-6);
+    assert(F32_Abs(Vec4_Dot(Vec4_Normalize(vec), unit) - 1.0f) < 1e-6);
+}
+
 void Test_Mat4Transpose(void) {
     Mat4 mat = {
         .x_row = {0.0, 0.1, 0.2, 0.3},
@@ -62,4 +258,1012 @@ void Test_Mat4IsEqual(void) {
     assert(!Mat4_IsEqual(mat, matNotEq));
 }
 
+void Test_Mat4Mul(void) {
+    Mat4 a = {
+        .x_row = {1.0, 2.0, 3.0, 4.0},
+        .y_row = {5.0, 6.0, 7.0, 8.0},
+        .z_row = {9.0, 10.0, 11.0, 12.0},
+        .w_row = {13.0, 14.0, 15.0, 16.0},
+    };
+    Mat4 b = {
+        .x_row = {1.0, 0.0, 2.0, 0.0},
+        .y_row = {0.0, 1.0, 0.0, 0.0},
+        .z_row = {0.0, 0.0, 1.0, 3.0},
+        .w_row = {0.0, 0.0, 0.0, 1.0},
+    };
+    Mat4 ab = {
+        .x_row = {1.0, 2.0, 5.0, 13.0},
+        .y_row = {5.0, 6.0, 17.0, 29.0},
+        .z_row = {9.0, 10.0, 29.0, 45.0},
+        .w_row = {13.0, 14.0, 41.0, 61.0},
+    };
+    Vec4 vec = {1.0, 0.0, -1.0, 2.0};
+    Vec4 a_vec = {6.0, 14.0, 22.0, 30.0};
+
+    assert(Mat4_IsEqual(Mat4_Mul(a, b), ab));
+    assert(Mat4_IsEqual(Mat4_Mul(a, Mat4_Identity()), a));
+    assert(Vec4_IsEqual(Mat4_MulVec4(a, vec), a_vec));
+}
+
+void Test_Mat4Inverse(void) {
+    Mat3 rot = {
+        .x_row = {0.0, -1.0, 0.0},
+        .y_row = {1.0, 0.0, 0.0},
+        .z_row = {0.0, 0.0, 1.0},
+    };
+    Mat4 pose = Mat4_Affine(rot, (Vec3){1.0, 2.0, 3.0});
+    Mat4 inv = {0};
+    Mat4 affine_inv = {0};
+    Mat4 singular = {.x_row = {1.0, 2.0, 3.0, 4.0}};
+
+    assert(Mat4_Inverse(pose, &inv) == SUCCESS);
+    assert(Mat4_AffineInverse(pose, &affine_inv) == SUCCESS);
+    assert(Mat4_IsEqual(inv, affine_inv));
+    assert(Mat4_IsEqual(Mat4_Mul(pose, inv), Mat4_Identity()));
+    assert(Mat4_IsEqual(Mat4_Mul(affine_inv, pose), Mat4_Identity()));
+    assert(Mat4_Inverse(singular, &inv) == FAILURE);
+}
+
+void Test_Mat4MulBatch(void) {
+    Mat4 a[5];
+    Mat4 b[5];
+    Mat4 out[5];
+    for (size_t i = 0; i < 5; ++i) {
+        f32* pa = (f32*)&a[i];
+        f32* pb = (f32*)&b[i];
+        for (size_t j = 0; j < 16; ++j) {
+            pa[j] = (f32)(i + j);
+            pb[j] = (f32)(i * j % 7);
+        }
+    }
+
+    Mat4_MulBatch(a, b, out, 5);
+    for (size_t i = 0; i < 5; ++i) {
+        assert(Mat4_IsEqual(out[i], Mat4_Mul(a[i], b[i])));
+    }
+    Mat4_MulBatch(a, b, a, 5);
+    for (size_t i = 0; i < 5; ++i) {
+        assert(Mat4_IsEqual(a[i], out[i]));
+    }
+}
+
+void Test_Vec3SoAKernels(void) {
+    static u8 buffer[1 << 16];
+    Stack arena = {0};
+    Stack_Init(&arena, buffer, sizeof(buffer));
+
+    size_t n = 13;
+    Vec3SoA a = {0};
+    Vec3SoA b = {0};
+    Vec3SoA out = {0};
+    assert(Vec3SoA_Init(&a, &arena, n) == SUCCESS);
+    assert(Vec3SoA_Init(&b, &arena, n) == SUCCESS);
+    assert(Vec3SoA_Init(&out, &arena, n) == SUCCESS);
+    assert(a.capacity == 16);
+    assert(((uintptr_t)a.x & (SOA_ALIGNMENT - 1)) == 0);
+    f32* dots = (f32*)Stack_AllocAlign(
+        &arena, a.capacity * sizeof(f32), SOA_ALIGNMENT
+    );
+    assert(dots != NULL);
+    for (size_t i = 0; i < n; ++i) {
+        Vec3SoA_Set(&a, i, (Vec3){(f32)i, 1.0f - (f32)i, 0.5f * (f32)i});
+        Vec3SoA_Set(&b, i, (Vec3){2.0f, (f32)(i % 3) + 1.0f, -1.0f});
+    }
+    Mat3 rot = {
+        .x_row = {0.0, -1.0, 0.0},
+        .y_row = {1.0, 0.0, 0.0},
+        .z_row = {0.0, 0.0, 1.0},
+    };
+
+    Vec3SoA_Rotate(&a, rot, &out);
+    for (size_t i = 0; i < n; ++i) {
+        Vec3 expected = Vec3_Rotate(Vec3SoA_Get(&a, i), rot);
+        assert(Vec3_IsEqual(Vec3SoA_Get(&out, i), expected));
+    }
+    Vec3SoA_Add(&a, &b, &out);
+    for (size_t i = 0; i < n; ++i) {
+        Vec3 expected = Vec3_Add(Vec3SoA_Get(&a, i), Vec3SoA_Get(&b, i));
+        assert(Vec3_IsEqual(Vec3SoA_Get(&out, i), expected));
+    }
+    Vec3SoA_Dot(&a, &b, dots);
+    for (size_t i = 0; i < n; ++i) {
+        assert(dots[i] == Vec3_Dot(Vec3SoA_Get(&a, i), Vec3SoA_Get(&b, i)));
+    }
+    Vec3SoA_Cross(&a, &b, &out);
+    for (size_t i = 0; i < n; ++i) {
+        Vec3 expected = Vec3_Cross(Vec3SoA_Get(&a, i), Vec3SoA_Get(&b, i));
+        assert(Vec3_IsEqual(Vec3SoA_Get(&out, i), expected));
+    }
+    Vec3SoA_Project(&a, &b, &out);
+    for (size_t i = 0; i < n; ++i) {
+        Vec3 expected = Vec3_Project(Vec3SoA_Get(&a, i), Vec3SoA_Get(&b, i));
+        Vec3 delta = Vec3_Sub(Vec3SoA_Get(&out, i), expected);
+        assert(Vec3_Mag(delta) < 1e-5);
+    }
+    Vec3SoA_Normalize(&b, &out);
+    for (size_t i = 0; i < n; ++i) {
+        assert(F32_Abs(Vec3_Mag(Vec3SoA_Get(&out, i)) - 1.0f) < 1e-6);
+    }
+}
+
+void Test_RotVec(void) {
+    Mat3 rot_z = {
+        .x_row = {0.0, -1.0, 0.0},
+        .y_row = {1.0, 0.0, 0.0},
+        .z_row = {0.0, 0.0, 1.0},
+    };
+    Mat3 identity = {
+        .x_row = {1.0, 0.0, 0.0},
+        .y_row = {0.0, 1.0, 0.0},
+        .z_row = {0.0, 0.0, 1.0},
+    };
+    Vec3 rvec_z = {0.0, 0.0, 0.5f * F32_PI};
+
+    assert(Test_Mat3IsClose(Mat3_FromRotVec(rvec_z), rot_z, TEST_ROT_ERR));
+    assert(Test_Mat3IsClose(
+        Mat3_FromRotVec((Vec3){0.0, 0.0, 0.0}), identity, TEST_ROT_ERR
+    ));
+    assert(Vec3_Mag(Vec3_Sub(Mat3_ToRotVec(rot_z), rvec_z)) < TEST_ROT_ERR);
+
+    // Round trip across small, generic and near-pi angles
+    Vec3 rvecs[] = {
+        {1e-7, -2e-7, 3e-7},
+        {0.3, -0.2, 0.1},
+        {-1.0, 2.0, 0.5},
+        {0.0, F32_PI - 1e-3f, 0.0},
+        {1.8, -1.8, 0.9},
+    };
+    for (size_t i = 0; i < sizeof(rvecs) / sizeof(rvecs[0]); ++i) {
+        Mat3 rot = Mat3_FromRotVec(rvecs[i]);
+        Vec3 back = Mat3_ToRotVec(rot);
+        assert(Vec3_Mag(Vec3_Sub(back, rvecs[i])) < 1e-4);
+        assert(Test_Mat3IsClose(Mat3_FromRotVec(back), rot, TEST_ROT_ERR));
+    }
+}
+
+void Test_RotVecBatch(void) {
+    static u8 buffer[1 << 16];
+    Stack arena = {0};
+    Stack_Init(&arena, buffer, sizeof(buffer));
+
+    size_t n = 11;
+    PoseSoA poses = {0};
+    assert(PoseSoA_Init(&poses, &arena, n) == SUCCESS);
+    for (size_t i = 0; i < n; ++i) {
+        f32 t = (f32)i - 5.0f;
+        Pose pose = {
+            .id = (u32)i,
+            .replicate_id = 0,
+            .rvec = {0.7f * t, -0.3f * t * t, 1e-3f * t},
+            .tvec = {t, 2.0f * t, 3.0f * t},
+        };
+        PoseSoA_Set(&poses, i, pose);
+    }
+    Mat3 rots[11];
+    Mat4 models[11];
+    Quat quats[11];
+
+    Vec3SoA_RotVecToMat3(&poses.rvec, rots);
+    PoseSoA_ToMat4(&poses, models);
+    Vec3SoA_RotVecToQuat(&poses.rvec, quats);
+    for (size_t i = 0; i < n; ++i) {
+        Pose pose = PoseSoA_Get(&poses, i);
+        Mat4 expected = Mat4_FromPose(pose);
+        assert(Test_Mat3IsClose(
+            rots[i], Mat3_FromRotVec(pose.rvec), TEST_ROT_ERR
+        ));
+        Quat quat = Quat_FromRotVec(pose.rvec);
+        assert(F32_Abs(quats[i].x - quat.x) < TEST_ROT_ERR);
+        assert(F32_Abs(quats[i].y - quat.y) < TEST_ROT_ERR);
+        assert(F32_Abs(quats[i].z - quat.z) < TEST_ROT_ERR);
+        assert(F32_Abs(quats[i].w - quat.w) < TEST_ROT_ERR);
+        const f32* ptr_out = (const f32*)&models[i];
+        const f32* ptr_expected = (const f32*)&expected;
+        for (size_t j = 0; j < 16; ++j) {
+            assert(F32_Abs(ptr_out[j] - ptr_expected[j]) < TEST_ROT_ERR);
+        }
+    }
+}
+
+void Test_Quat(void) {
+    Vec3 rvec = {0.3, -0.8, 0.5};
+    Vec3 vec = {1.0, 2.0, 3.0};
+    Quat quat = Quat_FromRotVec(rvec);
+    Mat3 rot = Mat3_FromRotVec(rvec);
+
+    assert(Test_Mat3IsClose(Quat_ToMat3(quat), rot, TEST_ROT_ERR));
+    Quat back = Quat_FromMat3(rot);
+    f32 alignment = Vec4_Dot(
+        (Vec4){back.x, back.y, back.z, back.w},
+        (Vec4){quat.x, quat.y, quat.z, quat.w}
+    );
+    assert(F32_Abs(F32_Abs(alignment) - 1.0f) < TEST_ROT_ERR);
+    Vec3 rotated = Quat_RotateVec3(quat, vec);
+    assert(Vec3_Mag(Vec3_Sub(rotated, Vec3_Rotate(vec, rot))) < TEST_ROT_ERR);
+
+    // q * conj(q) is the identity, and composition matches Mat3 rotation
+    Quat ident = Quat_Mul(quat, Quat_Conjugate(quat));
+    assert(F32_Abs(ident.w - 1.0f) < TEST_ROT_ERR);
+    Quat other = Quat_FromRotVec((Vec3){0.0, 0.0, 0.5f * F32_PI});
+    Vec3 composed = Quat_RotateVec3(Quat_Mul(other, quat), vec);
+    Vec3 sequential = Quat_RotateVec3(other, Quat_RotateVec3(quat, vec));
+    assert(Vec3_Mag(Vec3_Sub(composed, sequential)) < TEST_ROT_ERR);
+
+    // Halfway between identity and a 90 degree turn is a 45 degree turn
+    Quat half = Quat_Slerp(Quat_Identity(), other, 0.5f);
+    Quat expected = Quat_FromRotVec((Vec3){0.0, 0.0, 0.25f * F32_PI});
+    assert(F32_Abs(half.z - expected.z) < TEST_ROT_ERR);
+    assert(F32_Abs(half.w - expected.w) < TEST_ROT_ERR);
+    Quat nlerp = Quat_Nlerp(Quat_Identity(), other, 0.5f);
+    assert(F32_Abs(nlerp.z - expected.z) < TEST_ROT_ERR);
+}
+
+void Test_QuatResample(void) {
+    Quat rots[3] = {
+        Quat_Identity(),
+        Quat_FromRotVec((Vec3){0.0, 0.0, 1.0}),
+        Quat_FromRotVec((Vec3){0.0, 0.0, 2.0}),
+    };
+    Vec3 trans[3] = {{0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {2.0, 2.0, 0.0}};
+    Quat out_rots[5];
+    Vec3 out_trans[5];
+
+    Quat_ResampleTrajectory(rots, trans, 3, out_rots, out_trans, 5);
+    for (size_t i = 0; i < 5; ++i) {
+        Quat expected = Quat_FromRotVec((Vec3){0.0, 0.0, 0.5f * (f32)i});
+        assert(F32_Abs(out_rots[i].z - expected.z) < TEST_ROT_ERR);
+        assert(F32_Abs(out_rots[i].w - expected.w) < TEST_ROT_ERR);
+    }
+    assert(Vec3_IsEqual(out_trans[1], (Vec3){0.5, 0.0, 0.0}));
+    assert(Vec3_IsEqual(out_trans[3], (Vec3){1.5, 1.0, 0.0}));
+    assert(Vec3_IsEqual(out_trans[4], trans[2]));
+}
+
+void Test_ArenaGrowth(void) {
+    Arena arena = {0};
+    Arena_Init(&arena, 0);
+
+    u32* first = ArenaAlloc(&arena, u32, 16);
+    assert(first != NULL);
+    first[15] = 7;
+    ArenaBlock* first_block = arena.current;
+    ArenaMarker marker = Arena_Save(&arena);
+
+    // Larger than the first block, so it needs a new one
+    u8* big = (u8*)Arena_AllocAlign(&arena, 3 * ARENA_MIN_BLOCK_SIZE, 64);
+    assert(big != NULL);
+    assert(((uintptr_t)big & 63) == 0);
+    assert(arena.current != first_block);
+    assert(arena.current->prev == first_block);
+    big[3 * ARENA_MIN_BLOCK_SIZE - 1] = 1;
+
+    // Popping the only allocation in a block hands it back to the spare
+    ArenaBlock* big_block = arena.current;
+    Arena_Pop(&arena);
+    assert(arena.current == first_block);
+    assert(arena.spare == big_block);
+    assert(Arena_AllocAlign(&arena, 3 * ARENA_MIN_BLOCK_SIZE, 64) == big);
+    assert(arena.spare == NULL);
+
+    for (size_t i = 0; i < 64; ++i) {
+        assert(ArenaAlloc(&arena, f32, 1024) != NULL);
+    }
+    Arena_Restore(&arena, marker);
+    assert(arena.current == first_block);
+    assert(arena.current->stack.offset == marker.offset);
+    assert(first[15] == 7);
+
+    Arena_Pop(&arena);
+    assert(arena.current == NULL);
+    Arena_Free(&arena);
+    assert(arena.spare == NULL);
+}
+
+void Test_VirtualStack(void) {
+    VirtualStack arena = {0};
+    assert(VirtualStack_Init(&arena, (size_t)1 << 30));
+    assert(arena.committed == 0);
+
+    u8* header = (u8*)VirtualStack_AllocAlign(&arena, 10, 1);
+    assert(header != NULL);
+    memset(header, 1, 10);
+    size_t marker = VirtualStack_Save(&arena);
+
+    u32* items = (u32*)VirtualStack_AllocAlign(&arena, 16 * sizeof(u32), 64);
+    assert(((uintptr_t)items & 63) == 0);
+    items[15] = 42;
+    size_t n = 16;
+    while (n < (1 << 20)) {
+        n *= 2;
+        assert(VirtualStack_Grow(&arena, items, n * sizeof(u32), 64) == items);
+        items[n - 1] = (u32)n;
+    }
+    assert(items[15] == 42);
+    assert(arena.committed >= n * sizeof(u32));
+
+    VirtualStack_Restore(&arena, marker);
+    assert(VirtualStack_AllocAlign(&arena, sizeof(u32), 64) == items);
+    assert(header[9] == 1);
+
+    VirtualStack_Reset(&arena);
+    assert(arena.committed == 0 && arena.offset == 0);
+    u8* again = (u8*)VirtualStack_AllocAlign(&arena, 10, 1);
+    assert(again == header && again[0] == 0);
+    VirtualStack_Release(&arena);
+    assert(arena.base == NULL);
+}
+
+void Test_Pool(void) {
+    static u8 buffer[1 << 12];
+    Stack backing = {0};
+    Stack_Init(&backing, buffer, sizeof(buffer));
+    Pool pool = {0};
+    assert(Pool_Init(&pool, &backing, sizeof(Vec3), 16, 8));
+    assert(pool.slot_size == 16);
+    assert(((uintptr_t)pool.slots & 15) == 0);
+
+    Vec3* slots[8];
+    for (size_t i = 0; i < 8; ++i) {
+        slots[i] = (Vec3*)Pool_Alloc(&pool);
+        assert(slots[i] != NULL);
+        slots[i]->x = (f32)i;
+    }
+    assert(Pool_GetStats(&pool).used == 8);
+
+    // Frees in any order are reused most recent first
+    Pool_Free(&pool, slots[5]);
+    Pool_Free(&pool, slots[2]);
+    assert(Pool_Alloc(&pool) == slots[2]);
+    assert(Pool_Alloc(&pool) == slots[5]);
+    assert(slots[5]->x == 0.0f && slots[7]->x == 7.0f);
+    for (size_t i = 0; i < 8; ++i) {
+        Pool_Free(&pool, slots[i]);
+    }
+
+    PoolHandle handle = Pool_AllocHandle(&pool);
+    Vec3* value = (Vec3*)Pool_Get(&pool, handle);
+    assert(value != NULL);
+    Pool_FreeHandle(&pool, handle);
+    assert(Pool_Get(&pool, handle) == NULL);
+    PoolHandle reused = Pool_AllocHandle(&pool);
+    assert(reused.index == handle.index);
+    assert(Pool_Get(&pool, handle) == NULL);
+    assert(Pool_Get(&pool, reused) == value);
+    assert(Pool_Get(&pool, (PoolHandle){0}) == NULL);
+
+    PoolStats stats = Pool_GetStats(&pool);
+    assert(stats.used == 1 && stats.peak == 8 && stats.capacity == 8);
+}
+
+void Test_StackFlags(void) {
+    static u8 buffer[1 << 14];
+    Stack arena = {0};
+    Stack_Init(&arena, buffer, sizeof(buffer));
+
+    // Page alignment used to be silently capped at 128
+    u8* page = (u8*)Stack_AllocAlign(&arena, 64, 4096);
+    assert(page != NULL);
+    assert(((uintptr_t)page & 4095) == 0);
+    memset(page, 0xAB, 64);
+    size_t marker = Stack_Save(&arena);
+
+    u8* scratch = (u8*)Stack_AllocAlignFlags(&arena, 256, 64, ALLOC_POISON);
+    assert(((uintptr_t)scratch & 63) == 0);
+#ifndef NDEBUG
+    assert(scratch[0] == ALLOC_POISON_BYTE && scratch[255] == ALLOC_POISON_BYTE);
+#endif
+    memset(scratch, 0xEE, 256);
+    assert(Stack_AllocAlignFlags(&arena, 512, 64, ALLOC_NO_ZERO) != NULL);
+
+    // Restore neither clears nor touches the memory below the marker
+    Stack_Restore(&arena, marker);
+    assert(arena.offset == marker);
+    assert(scratch[0] == 0xEE);
+    assert(page[63] == 0xAB);
+    u8* reused = (u8*)Stack_AllocAlignFlags(&arena, 256, 64, ALLOC_NO_ZERO);
+    assert(reused == scratch && reused[0] == 0xEE);
+    u8* zeroed = (u8*)Stack_AllocAlign(&arena, 16, 64);
+    assert(zeroed[0] == 0 && zeroed[15] == 0);
+
+    // Pop still unwinds past a restore point
+    Stack_Pop(&arena);
+    Stack_Pop(&arena);
+    Stack_Pop(&arena);
+    assert(arena.offset == 0);
+}
+
+void Test_Scratch(void) {
+    Scratch outer = Scratch_Begin(NULL, 0);
+    assert(outer.arena != NULL);
+    f32* result = ArenaAlloc(outer.arena, f32, 4);
+    result[3] = 1.0f;
+
+    // A callee writing its result into `outer` must get the other arena
+    Scratch inner = Scratch_Begin(&outer.arena, 1);
+    assert(inner.arena != NULL && inner.arena != outer.arena);
+    f32* tmp = ArenaAlloc(inner.arena, f32, 1 << 16);
+    assert(tmp != NULL);
+    assert(ArenaAlloc(outer.arena, f32, 4) != NULL);
+    Scratch_End(inner);
+    assert(result[3] == 1.0f);
+
+    // Nested scopes on the same arena unwind in order
+    size_t offset = outer.arena->current->stack.offset;
+    Scratch nested = Scratch_Begin(NULL, 0);
+    assert(nested.arena == outer.arena);
+    assert(ArenaAlloc(nested.arena, f32, 1 << 16) != NULL);
+    Scratch_End(nested);
+    assert(outer.arena->current->stack.offset == offset);
+
+    Scratch_End(outer);
+    assert(outer.arena->current == NULL);
+    Scratch_ReleaseThread();
+}
+
+void Test_StringBuilder(void) {
+    String str = {0};
+    assert(String_IsEmpty(&str) && String_IsInline(&str));
+
+    // Short strings stay inside the struct
+    assert(String_AppendStr(&str, "pose") == SUCCESS);
+    assert(String_AppendChar(&str, '_') == SUCCESS);
+    assert(String_AppendU64(&str, 1234567890) == SUCCESS);
+    assert(String_IsInline(&str));
+    assert(str.size == 15 && memcmp(String_Data(&str), "pose_1234567890", 15) == 0);
+
+    // Growing past the inline buffer keeps the contents
+    assert(String_AppendMany(&str, ", ", "a", "b", NULL) == SUCCESS);
+    assert(!String_IsInline(&str));
+    assert(str.capacity >= STRING_MIN_HEAP_CAPACITY);
+    StringView view = String_View(&str);
+    assert(view.length == 19 && memcmp(view.start, "pose_1234567890, ab", 19) == 0);
+    for (size_t i = 0; i < 1000; ++i) {
+        assert(String_AppendChar(&str, (char)('a' + i % 26)) == SUCCESS);
+    }
+    assert(str.size == 1019 && String_Data(&str)[1018] == 'a' + 999 % 26);
+
+    String_Reset(&str);
+    assert(String_AppendVec3(&str, (Vec3){0.5f, -1.25f, 3.0f}) == SUCCESS);
+    assert(str.size == 15 && memcmp(String_Data(&str), "[0.5, -1.25, 3]", 15) == 0);
+    String_Reset(&str);
+    Pose pose = {7, 2, {0.1f, -0.2f, 1e-7f}, {100.0f, 2.5e10f, -0.0f}};
+    assert(String_AppendPose(&str, pose) == SUCCESS);
+    const char* line = "7,2,0.1,-0.2,1e-7,100,2.5e10,-0\n";
+    assert(str.size == strlen(line));
+    assert(memcmp(String_Data(&str), line, str.size) == 0);
+
+    char* detached = String_Detach(&str);
+    assert(detached != NULL && detached[0] == '7');
+    assert(String_IsEmpty(&str) && String_IsInline(&str));
+    free(detached);
+    String_Free(&str);
+}
+
+void Test_F32Format(void) {
+    struct {
+        f32 value;
+        const char* text;
+    } cases[] = {
+        {0.0f, "0"},
+        {1.0f, "1"},
+        {-2.5f, "-2.5"},
+        {0.1f, "0.1"},
+        {0.3f, "0.3"},
+        {1.0f / 3.0f, "0.33333334"},
+        {F32_PI, "3.1415927"},
+        {123456792.0f, "123456790"},
+        {1e9f, "1e9"},
+        {1e-5f, "0.00001"},
+        {1.5e-6f, "1.5e-6"},
+        {3.4028235e38f, "3.4028235e38"},
+        {1.17549435e-38f, "1.1754944e-38"},
+        {1e-45f, "1e-45"},
+        {16777216.0f, "16777216"},
+    };
+    char buffer[F32_FORMAT_MAX];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        size_t length = F32_Format(cases[i].value, buffer);
+        assert(length == strlen(cases[i].text));
+        assert(memcmp(buffer, cases[i].text, length) == 0);
+    }
+
+    // Every output must parse back to the same bits
+    u32 bits = 0x12345678u;
+    char text[F32_FORMAT_MAX + 1];
+    for (size_t i = 0; i < 100000; ++i) {
+        bits = bits * 1664525u + 1013904223u;
+        f32 value;
+        memcpy(&value, &bits, sizeof(value));
+        if (value != value) continue;
+        size_t length = F32_Format(value, text);
+        assert(length <= F32_FORMAT_MAX);
+        text[length] = '\0';
+        f32 parsed = strtof(text, NULL);
+        assert(memcmp(&parsed, &value, sizeof(value)) == 0);
+    }
+}
+
+void Test_ScanSpans(void) {
+    // A single delimiter on either side of the 16 and 32 byte SIMD blocks,
+    // in buffers that end inside, on and just past a block
+    const size_t positions[] = {0, 1, 14, 15, 16, 17, 30, 31, 32, 33, 63, 64};
+    const size_t lengths[] = {1, 15, 16, 17, 31, 32, 33, 48, 64, 65, 100};
+    char buf[128];
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+        for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]);
+             ++p) {
+            if (positions[p] >= lengths[l]) continue;
+            memset(buf, 'x', lengths[l]);
+            buf[positions[p]] = '\n';
+            Test_CheckScan(buf, lengths[l], '\n', '\n', 64);
+            buf[positions[p]] = ',';
+            Test_CheckScan(buf, lengths[l], ',', '\n', 64);
+        }
+    }
+
+    // Dense random mixes of both delimiters, every length through the
+    // scalar tail, scanned whole and in small batches
+    const char alphabet[] = "ab,\n";
+    u32 state = 0x2545F491u;
+    for (size_t round = 0; round < 64; ++round) {
+        for (size_t len = 0; len <= sizeof(buf); ++len) {
+            for (size_t i = 0; i < len; ++i) {
+                state = state * 1664525u + 1013904223u;
+                buf[i] = alphabet[(state >> 24) % 4];
+            }
+            Test_CheckScan(buf, len, '\n', '\n', 160);
+            Test_CheckScan(buf, len, ',', '\n', 160);
+            Test_CheckScan(buf, len, ',', '\n', 3);
+            Test_CheckScan(buf, len, ',', '\n', 1);
+        }
+    }
+
+    // Empty input and only delimiters
+    Span spans[4];
+    size_t consumed = 1;
+    assert(StringView_ScanSpans(Test_View(""), '\n', spans, 4, &consumed) == 0);
+    assert(consumed == 0);
+    assert(StringView_ScanFields(Test_View(",\n"), ',', '\n', spans, 4,
+                                 &consumed) == 2);
+    assert(consumed == 2 && spans[1].offset == 1 && spans[1].length == 0);
+}
+
+void Test_PosesParseCSV(void) {
+    VecPose poses = {0};
+    const char* valid =
+        "id,replicate,rx,ry,rz,tx,ty,tz\r\n"
+        "7, 2, 0.5, -1.25, 3, 10, 20.5, -30\r\n"
+        "\r\n"
+        "8,0,0,0,0,1e-3,-2E2,.5";
+    assert(Poses_ParseCSV(Test_View(valid), &poses) == EXIT_OK);
+    assert(poses.size == 2);
+    assert(poses.items[0].id == 7 && poses.items[0].replicate_id == 2);
+    assert(poses.items[0].rvec.x == 0.5f && poses.items[0].rvec.y == -1.25f);
+    assert(poses.items[0].rvec.z == 3.0f && poses.items[0].tvec.x == 10.0f);
+    assert(poses.items[0].tvec.y == 20.5f && poses.items[0].tvec.z == -30.0f);
+    assert(poses.items[1].id == 8 && poses.items[1].tvec.x == 1e-3f);
+    assert(poses.items[1].tvec.y == -200.0f && poses.items[1].tvec.z == 0.5f);
+
+    // A valid first line means none of these failures pass as a header
+    const char* invalid[] = {
+        "1,0,0,0,0,0,0,0\n1,0,0,0,0,0,0\n",
+        "1,0,0,0,0,0,0,0\n1,0,0,0,0,x,0,0\n",
+        "1,0,0,0,0,0,0,0\n1,0,0,0,0,1.5.2,0,0\n",
+        "1,0,0,0,0,0,0,0\n-1,0,0,0,0,0,0,0\n",
+        "1,0,0,0,0,0,0,0\n1,0,0,0,0,0,0,0,\n",
+        "1,0,0,0,0,0,0,0\n1,0,0,0,0,0,0,0,0\n",
+        "1,0,0,0,0,0,0,0\n1,0,0,,0,0,0,0\n",
+        "1,0,0,0,0,0,0,0\n1,0,0,0,0,0,0,0,",
+        "1,0,0,0,0,0,0,0\n1,0,0,0,0,0,0,0\r\n,",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        VecPose_Reset(&poses);
+        assert(Poses_ParseCSV(Test_View(invalid[i]), &poses) == EXIT_ERR);
+    }
+
+    // Only a first line that does not start with a number is a header; a
+    // bad data row in first place is an error, not a skipped header
+    const char* bad_first[] = {
+        "1,0,0,0,0,x,0,0\n2,0,0,0,0,0,0,0\n",
+        "1,0,0\n2,0,0,0,0,0,0,0\n",
+        "-1.5,0,0,0,0,0,0,0\n2,0,0,0,0,0,0,0\n",
+    };
+    for (size_t i = 0; i < sizeof(bad_first) / sizeof(bad_first[0]); ++i) {
+        VecPose_Reset(&poses);
+        assert(Poses_ParseCSV(Test_View(bad_first[i]), &poses) == EXIT_ERR);
+    }
+    VecPose_Reset(&poses);
+    assert(Poses_ParseCSV(Test_View("id,pose\n2,0,0,0,0,0,0,0\n"), &poses) ==
+           EXIT_OK);
+    assert(poses.size == 1 && poses.items[0].id == 2);
+
+    // Same rules through the file loader
+    VecPose_Reset(&poses);
+    Test_WriteFile(TEST_CSV_PATH, valid);
+    assert(Poses_LoadCSV(TEST_CSV_PATH, &poses, 1) == EXIT_OK);
+    assert(poses.size == 2 && poses.items[1].tvec.z == 0.5f);
+    VecPose_Reset(&poses);
+    Test_WriteFile(TEST_CSV_PATH, invalid[0]);
+    assert(Poses_LoadCSV(TEST_CSV_PATH, &poses, 1) == EXIT_ERR);
+    assert(remove(TEST_CSV_PATH) == 0);
+    VecPose_Free(&poses);
+}
+
+void Test_PosesParseParallel(void) {
+    // Lines of uneven length so chunk cuts land mid-line
+    String csv = {0};
+    assert(String_AppendStr(&csv, "id,replicate,rx,ry,rz,tx,ty,tz\n") ==
+           SUCCESS);
+    for (u32 i = 0; i < 40; ++i) {
+        Pose pose = {
+            i, i % 3, {0.25f * (f32)i, -1.0f, 1e-3f * (f32)(i * i)},
+            {(f32)(i * 7919), 0.5f, -(f32)i},
+        };
+        assert(String_AppendPose(&csv, pose) == SUCCESS);
+        if (i % 9 == 4) {
+            assert(String_AppendStr(&csv, "\r\n") == SUCCESS);
+        }
+    }
+    StringView content = String_View(&csv);
+    // Also without the final newline
+    StringView unterminated = {content.start, content.length - 1};
+
+    VecPose serial = {0};
+    VecPose parallel = {0};
+    assert(Poses_ParseCSV(content, &serial) == EXIT_OK);
+    assert(serial.size == 40);
+    const size_t thread_counts[] = {1, 2, 3, 4, 7, 16, 39, 40, 41, 48};
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]);
+         ++t) {
+        VecPose_Reset(&parallel);
+        assert(Poses_ParseCSVParallel(content, &parallel, thread_counts[t]) ==
+               EXIT_OK);
+        assert(parallel.size == serial.size);
+        assert(memcmp(parallel.items, serial.items,
+                      serial.size * sizeof(Pose)) == 0);
+
+        VecPose_Reset(&parallel);
+        assert(Poses_ParseCSVParallel(unterminated, &parallel,
+                                      thread_counts[t]) == EXIT_OK);
+        assert(parallel.size == serial.size);
+        assert(memcmp(parallel.items, serial.items,
+                      serial.size * sizeof(Pose)) == 0);
+    }
+
+    // Results are appended after what is already there
+    assert(Poses_ParseCSVParallel(content, &parallel, 5) == EXIT_OK);
+    assert(parallel.size == 2 * serial.size);
+    assert(memcmp(&parallel.items[serial.size], serial.items,
+                  serial.size * sizeof(Pose)) == 0);
+
+    // A bad line in any chunk fails the whole parse
+    char* middle = memchr(&content.start[content.length / 2], '\n',
+                          content.length / 2);
+    assert(middle != NULL);
+    middle[1] = 'x';
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]);
+         ++t) {
+        VecPose_Reset(&parallel);
+        assert(Poses_ParseCSVParallel(content, &parallel, thread_counts[t]) ==
+               EXIT_ERR);
+    }
+
+    VecPose_Free(&parallel);
+    VecPose_Free(&serial);
+    String_Free(&csv);
+}
+
+void Test_ParseNumbers(void) {
+    const char* texts[] = {
+        // Exactly halfway between two floats rounds to even, any excess up
+        "16777217", "16777219", "16777217.000000000000000000001",
+        "1.000000059604644775390625", "1.000000059604644775390626",
+        "1.000000178813934326171875", "0.500000014901161193847656250",
+        // Subnormals and underflow
+        "1e-45", "1.4e-45", "7e-46", "7.1e-46", "1.17549421e-38",
+        "1.1754942e-38", "5.877472e-39", "1e-50", "-1e-45",
+        // Around and past FLT_MAX
+        "3.4028235e38", "3.40282356e38", "3.40282357e38", "3.5e38", "1e39",
+        "-1e39", "1e100000", "0.0001e42",
+        // More digits than fit the 19 digit mantissa
+        "0.1000000000000000000000000000001",
+        "123456789012345678901234567890",
+        "3.14159265358979323846264338327950288419716939937510",
+        "0.000000000000000000000000000000000000011754943508222875",
+        "9999999999999999999999", "00000000000000000000000001.5",
+        // Plain inputs through the fast path
+        "0", "-0", "1", "-2.5", "0.1", "+7", ".5", "5.", "1E3", "2e-3",
+    };
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i) {
+        f32 parsed = 0.0f;
+        assert(StringView_ParseF32(Test_View(texts[i]), &parsed) == EXIT_OK);
+        f32 expected = strtof(texts[i], NULL);
+        assert(memcmp(&parsed, &expected, sizeof(parsed)) == 0);
+    }
+
+    // Random digit strings and exponents, checked against strtof
+    u32 state = 0x9E3779B9u;
+    char text[64];
+    for (size_t i = 0; i < 20000; ++i) {
+        size_t length = 0;
+        state = state * 1664525u + 1013904223u;
+        size_t n_digits = 1 + (state >> 24) % 30;
+        size_t point = (state >> 8) % (n_digits + 1);
+        for (size_t d = 0; d < n_digits; ++d) {
+            if (d == point) text[length++] = '.';
+            state = state * 1664525u + 1013904223u;
+            text[length++] = (char)('0' + (state >> 24) % 10);
+        }
+        state = state * 1664525u + 1013904223u;
+        int exponent = (int)((state >> 16) % 100) - 60;
+        length += (size_t)sprintf(&text[length], "e%d", exponent);
+        f32 parsed = 0.0f;
+        StringView view = {.start = text, .length = length};
+        assert(StringView_ParseF32(view, &parsed) == EXIT_OK);
+        f32 expected = strtof(text, NULL);
+        assert(memcmp(&parsed, &expected, sizeof(parsed)) == 0);
+    }
+
+    const char* invalid_floats[] = {"", "-", ".", "e5", "1e", "1e+", "1.2.3",
+                                    "1,5", "0x", "abc"};
+    for (size_t i = 0;
+         i < sizeof(invalid_floats) / sizeof(invalid_floats[0]); ++i) {
+        f32 parsed = 0.0f;
+        assert(StringView_ParseF32(Test_View(invalid_floats[i]), &parsed) ==
+               EXIT_ERR);
+    }
+
+    u32 id = 0;
+    assert(StringView_ParseU32(Test_View("0"), &id) == EXIT_OK && id == 0);
+    assert(StringView_ParseU32(Test_View("4294967295"), &id) == EXIT_OK);
+    assert(id == UINT32_MAX);
+    assert(StringView_ParseU32(Test_View("4294967296"), &id) == EXIT_ERR);
+    assert(StringView_ParseU32(Test_View("99999999999999999999"), &id) ==
+           EXIT_ERR);
+    assert(StringView_ParseU32(Test_View(""), &id) == EXIT_ERR);
+    assert(StringView_ParseU32(Test_View("-1"), &id) == EXIT_ERR);
+    assert(StringView_ParseU32(Test_View("12a"), &id) == EXIT_ERR);
+}
+
+void Test_PoseRoundTrip(void) {
+    // Poses written by String_AppendPose must parse back to the same bits
+    String csv = {0};
+    VecPose expected = {0};
+    u32 state = 0xC0FFEEu;
+    for (u32 i = 0; i < 2000; ++i) {
+        Pose* pose = VecPose_Alloc(&expected);
+        assert(pose != NULL);
+        pose->id = i;
+        pose->replicate_id = state % 7;
+        f32 values[6];
+        for (size_t v = 0; v < 6; ++v) {
+            // Arbitrary finite bit patterns, NaN and inf excluded
+            u32 bits;
+            do {
+                state = state * 1664525u + 1013904223u;
+                bits = state;
+            } while ((bits & 0x7F800000u) == 0x7F800000u);
+            memcpy(&values[v], &bits, sizeof(bits));
+        }
+        pose->rvec = (Vec3){values[0], values[1], values[2]};
+        pose->tvec = (Vec3){values[3], values[4], values[5]};
+        assert(String_AppendPose(&csv, *pose) == SUCCESS);
+    }
+
+    VecPose parsed = {0};
+    assert(Poses_ParseCSV(String_View(&csv), &parsed) == EXIT_OK);
+    assert(parsed.size == expected.size);
+    assert(memcmp(parsed.items, expected.items,
+                  expected.size * sizeof(Pose)) == 0);
+
+    VecPose_Free(&parsed);
+    VecPose_Free(&expected);
+    String_Free(&csv);
+}
+
+void Test_PoseCache(void) {
+    const char* csv =
+        "id,replicate,rx,ry,rz,tx,ty,tz\n"
+        "1,0,0.1,0.2,0.3,1,2,3\n"
+        "2,1,-0.1,-0.2,-0.3,-1,-2,-3\n"
+        "3,2,0,0,1.5,100,200,300\n";
+    VecPose poses = {0};
+    assert(Poses_ParseCSV(Test_View(csv), &poses) == EXIT_OK);
+    assert(poses.size == 3);
+
+    // Write then open
+    PoseCache cache = {0};
+    assert(PoseCache_Write(TEST_CACHE_PATH, poses.items, poses.size, NULL) ==
+           EXIT_OK);
+    assert(PoseCache_Open(&cache, TEST_CACHE_PATH) == EXIT_OK);
+    assert(cache.mapped);
+    assert(PoseCache_Verify(&cache) == EXIT_OK);
+    Test_CheckPoseCache(&cache, poses.items, poses.size);
+    PoseCache_Close(&cache);
+    assert(cache.data == NULL);
+
+    // Header fields that do not match the file are rejected on open
+    u32 bad_word = 0xDEADBEEFu;
+    size_t magic_offset = offsetof(PoseCacheHeader, magic);
+    size_t version_offset = offsetof(PoseCacheHeader, version);
+    size_t count_offset = offsetof(PoseCacheHeader, count);
+    size_t header_offsets[] = {magic_offset, version_offset, count_offset};
+    for (size_t i = 0; i < 3; ++i) {
+        assert(PoseCache_Write(
+                   TEST_CACHE_PATH, poses.items, poses.size, NULL
+               ) == EXIT_OK);
+        Test_PatchFile(TEST_CACHE_PATH, (long)header_offsets[i], &bad_word,
+                       sizeof(bad_word));
+        assert(PoseCache_Open(&cache, TEST_CACHE_PATH) == EXIT_ERR);
+        assert(cache.data == NULL);
+    }
+    // Counts whose stride or file size would wrap around, on a file that
+    // holds nothing but a header with a matching checksum of zero
+    u64 huge_counts[] = {UINT64_MAX, 1ull << 60, UINT64_MAX - 15};
+    for (size_t i = 0; i < sizeof(huge_counts) / sizeof(huge_counts[0]);
+         ++i) {
+        PoseCacheHeader header = {
+            .magic = POSE_CACHE_MAGIC,
+            .version = POSE_CACHE_VERSION,
+            .count = huge_counts[i],
+            .stride = (huge_counts[i] + 15) & ~(u64)15,
+            .data_offset = sizeof(PoseCacheHeader),
+        };
+        FILE* header_file = fopen(TEST_CACHE_PATH, "wb");
+        assert(header_file != NULL);
+        assert(fwrite(&header, sizeof(header), 1, header_file) == 1);
+        assert(fclose(header_file) == 0);
+        assert(PoseCache_Open(&cache, TEST_CACHE_PATH) == EXIT_ERR);
+        assert(cache.data == NULL);
+    }
+
+    // So is a file of the wrong size, truncated or not
+    assert(PoseCache_Write(TEST_CACHE_PATH, poses.items, poses.size, NULL) ==
+           EXIT_OK);
+    FILE* file = fopen(TEST_CACHE_PATH, "ab");
+    assert(file != NULL && fputc(0, file) == 0 && fclose(file) == 0);
+    assert(PoseCache_Open(&cache, TEST_CACHE_PATH) == EXIT_ERR);
+    Test_WriteFile(TEST_CACHE_PATH, "POSE");
+    assert(PoseCache_Open(&cache, TEST_CACHE_PATH) == EXIT_ERR);
+
+    // A flipped data byte opens but fails the checksum
+    assert(PoseCache_Write(TEST_CACHE_PATH, poses.items, poses.size, NULL) ==
+           EXIT_OK);
+    f32 wrong = 42.0f;
+    long data_offset = (long)(sizeof(PoseCacheHeader) + 16 * 4 * 5);
+    Test_PatchFile(TEST_CACHE_PATH, data_offset, &wrong, sizeof(wrong));
+    assert(PoseCache_Open(&cache, TEST_CACHE_PATH) == EXIT_OK);
+    assert(cache.poses.tvec.x[0] == 42.0f);
+    assert(PoseCache_Verify(&cache) == EXIT_ERR);
+    PoseCache_Close(&cache);
+
+    // Load builds the cache once, then trusts its header while the CSV
+    // keeps its size and modification time
+    Test_WriteFile(TEST_CSV_PATH, csv);
+    assert(PoseCache_Load(&cache, TEST_CSV_PATH, 1, false) == EXIT_OK);
+    assert(cache.mapped);
+    Test_CheckPoseCache(&cache, poses.items, poses.size);
+    PoseCache_Close(&cache);
+    Test_PatchFile(TEST_CACHE_PATH, data_offset, &wrong, sizeof(wrong));
+    assert(PoseCache_Load(&cache, TEST_CSV_PATH, 1, false) == EXIT_OK);
+    assert(cache.poses.tvec.x[0] == 42.0f);
+    PoseCache_Close(&cache);
+    // Verifying catches the damage and rebuilds from the CSV
+    assert(PoseCache_Load(&cache, TEST_CSV_PATH, 1, true) == EXIT_OK);
+    Test_CheckPoseCache(&cache, poses.items, poses.size);
+    PoseCache_Close(&cache);
+    assert(PoseCache_Open(&cache, TEST_CACHE_PATH) == EXIT_OK);
+    assert(PoseCache_Verify(&cache) == EXIT_OK);
+    PoseCache_Close(&cache);
+
+    // A changed CSV makes the cache stale, whatever the file times say
+    const char* csv_more =
+        "id,replicate,rx,ry,rz,tx,ty,tz\n"
+        "1,0,0.1,0.2,0.3,1,2,3\n"
+        "2,1,-0.1,-0.2,-0.3,-1,-2,-3\n"
+        "3,2,0,0,1.5,100,200,300\n"
+        "4,3,1,1,1,4,4,4\n";
+    VecPose more = {0};
+    assert(Poses_ParseCSV(Test_View(csv_more), &more) == EXIT_OK);
+    Test_WriteFile(TEST_CSV_PATH, csv_more);
+    assert(PoseCache_Load(&cache, TEST_CSV_PATH, 1, false) == EXIT_OK);
+    Test_CheckPoseCache(&cache, more.items, more.size);
+    PoseCache_Close(&cache);
+    VecPose_Free(&more);
+    Test_WriteFile(TEST_CSV_PATH, csv);
+    assert(remove(TEST_CACHE_PATH) == 0);
+
+    // A cache path that cannot be replaced keeps the image on the heap
+    assert(mkdir(TEST_CACHE_PATH, 0755) == 0);
+    assert(PoseCache_Load(&cache, TEST_CSV_PATH, 1, false) == EXIT_OK);
+    assert(!cache.mapped);
+    assert(PoseCache_Verify(&cache) == EXIT_OK);
+    Test_CheckPoseCache(&cache, poses.items, poses.size);
+    PoseCache_Close(&cache);
+    assert(rmdir(TEST_CACHE_PATH) == 0);
+
+    assert(remove(TEST_CSV_PATH) == 0);
+    VecPose_Free(&poses);
+}
+
+void Test_LineIndex(void) {
+    const char* texts[] = {
+        "",          "\n",           "\n\n\n",      "a",
+        "a\n",       "a\n\n",        "\na",         "a\nbc\n\n\nd",
+        "a,b,,c,",   "\r\n\r\n",     "one line without a delimiter at all",
+    };
+    String str = {0};
+    LineIndex index = {0};
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i) {
+        String_Reset(&str);
+        if (texts[i][0] != '\0') {
+            assert(String_AppendStr(&str, texts[i]) == SUCCESS);
+        }
+        // The same index is rebuilt for each input
+        Test_CheckSplitIndex(&str, '\n', &index);
+        Test_CheckSplitIndex(&str, ',', &index);
+    }
+    String_Reset(&str);
+    assert(String_AppendStr(&str, "a\nbc\n\n\nd\n") == SUCCESS);
+    Test_CheckSplitIndex(&str, '\n', &index);
+    assert(index.size == 3);
+    assert(index.items[1].offset == 2 && index.items[1].length == 2);
+    assert(index.items[2].offset == 7 && index.items[2].length == 1);
+
+    // Far more lines than the initial length / 64 + 16 guess, with empty
+    // ones mixed in, forces several reallocations mid-scan
+    String_Reset(&str);
+    for (size_t i = 0; i < 5000; ++i) {
+        assert(String_AppendU64(&str, i % 10) == SUCCESS);
+        assert(String_AppendStr(&str, i % 7 == 0 ? "\n\n" : "\n") == SUCCESS);
+    }
+    size_t initial_capacity = str.size / 64 + 16;
+    Test_CheckSplitIndex(&str, '\n', &index);
+    assert(index.size == 5000);
+    assert(index.capacity > initial_capacity);
+    StringView last = LineIndex_Get(&index, 4999);
+    assert(last.length == 1 && last.start[0] == '9');
+
+    LineIndex_Reset(&index);
+    assert(LineIndex_IsEmpty(&index));
+    LineIndex_Free(&index);
+    assert(index.items == NULL);
+    String_Free(&str);
+}
+
+#ifdef ALLOC_TRACE
+void Test_AllocTrace(void) {
+    static u8 buffer[1 << 12];
+    Stack arena = {0};
+    Stack_Init(&arena, buffer, sizeof(buffer));
+    String str = {0};
+
+    // Append growth is charged to the append, not the last traced call
+    int stack_line = __LINE__ + 1;
+    assert(Stack_AllocAlign(&arena, 64, 16) != NULL);
+    int append_line = __LINE__ + 2;
+    for (size_t i = 0; i < 1000; ++i) {
+        assert(String_AppendStr(&str, "growth") == SUCCESS);
+    }
+    assert(Test_TraceCount("Stack", __FILE__, stack_line) == 1);
+    assert(Test_TraceCount("String", __FILE__, stack_line) == 0);
+    assert(Test_TraceCount("String", __FILE__, append_line) > 1);
+
+    // Different allocators on one line are separate sites
+    String other = {0};
+    int shared_line = __LINE__ + 1;
+    Stack_AllocAlign(&arena, 8, 8); String_Reserve(&other, 4096);
+    assert(Test_TraceCount("Stack", __FILE__, shared_line) == 1);
+    assert(Test_TraceCount("String", __FILE__, shared_line) == 1);
+
+    // A failed request records nothing
+    int failed_line = __LINE__ + 1;
+    assert(Stack_AllocAlign(&arena, sizeof(buffer), 16) == NULL);
+    assert(Test_TraceCount("Stack", __FILE__, failed_line) == 0);
+
+    String_Free(&other);
+    String_Free(&str);
+}
+#endif /* ALLOC_TRACE */
+
 #endif /* TESTS_H */
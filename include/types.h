@@ -2,7 +2,6 @@
 #define TYPES_H
 
 #include <math.h>
-#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -10,74 +9,11 @@
 #include <string.h>
 #include <unistd.h>
 
-#define VEC_MAX_WRITE 64
-#define EPSILON 1e-9
+#include "base.h"
+#include "str.h"
 
-typedef enum {
-    SUCCESS,
-    FAILURE,
-} RETURN_STATUS;
-
-typedef uint8_t u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-typedef size_t usize;
-
-typedef int8_t i8;
-typedef int16_t i16;
-typedef int32_t i32;
-typedef int64_t i64;
-typedef ssize_t isize;
-
-typedef float f32;
-typedef double f64;
-
-typedef struct String String;
-typedef struct Vec3 Vec3;
-typedef struct Vec4 Vec4;
-typedef struct Mat3 Mat3;
-typedef struct Mat4 Mat4;
-
-struct String {
-    char* begin;
-    size_t size;
-    size_t capacity;
-};
-
-struct Vec3 {
-    f32 x;
-    f32 y;
-    f32 z;
-};
-
-struct Vec4 {
-    f32 x;
-    f32 y;
-    f32 z;
-    f32 w;
-};
-
-struct Mat3 {
-    Vec3 x_row;
-    Vec3 y_row;
-    Vec3 z_row;
-};
-
-struct Mat4 {
-    Vec4 x_row;
-    Vec4 y_row;
-    Vec4 z_row;
-    Vec4 w_row;
-};
-
-RETURN_STATUS String_Append(String* str, char* start, size_t len);
-RETURN_STATUS String_AppendStr(String* str, const char* input_str);
-RETURN_STATUS String_AppendMany(String* str, ...);
-RETURN_STATUS String_AppendVec3(String* str, Vec3 vec);
-RETURN_STATUS String_AppendVec4(String* str, Vec4 vec);
-RETURN_STATUS String_AppendMat4(String* str, Mat4 mat);
-RETURN_STATUS String_CheckCapacity(String* str, size_t len);
+#define EPSILON 1e-9
+#define F32_PI 3.14159265358979323846f
 
 f32 F32_Abs(f32 value);
 
@@ -101,111 +37,72 @@ Vec4 Vec4_Normalize(Vec4 vec);
 
 bool Mat3_IsEqual(Mat3 a, Mat3 b);
 Mat3 Mat3_Orthonormalize(Mat3 mat);
+Mat3 Mat3_FromRotVec(Vec3 rvec);
+Vec3 Mat3_ToRotVec(Mat3 rot);
 
 bool Mat4_IsEqual(Mat4 a, Mat4 b);
 Mat4 Mat4_Transpose(Mat4 mat);
+Mat4 Mat4_Identity(void);
+Mat4 Mat4_Affine(Mat3 rot, Vec3 trans);
+Mat4 Mat4_FromPose(Pose pose);
+Mat4 Mat4_Mul(Mat4 a, Mat4 b);
+Vec4 Mat4_MulVec4(Mat4 mat, Vec4 vec);
+RETURN_STATUS Mat4_Inverse(Mat4 mat, Mat4* inv);
+RETURN_STATUS Mat4_AffineInverse(Mat4 mat, Mat4* inv);
+void Mat4_MulBatch(const Mat4* a, const Mat4* b, Mat4* out, size_t n);
+
+Quat Quat_Identity(void);
+Quat Quat_Mul(Quat a, Quat b);
+Quat Quat_Conjugate(Quat quat);
+Quat Quat_Normalize(Quat quat);
+Vec3 Quat_RotateVec3(Quat quat, Vec3 vec);
+Quat Quat_FromRotVec(Vec3 rvec);
+Quat Quat_FromMat3(Mat3 rot);
+Mat3 Quat_ToMat3(Quat quat);
+Quat Quat_Nlerp(Quat a, Quat b, f32 t);
+Quat Quat_Slerp(Quat a, Quat b, f32 t);
+void Quat_ResampleTrajectory(
+    const Quat* rots,
+    const Vec3* trans,
+    size_t n_keys,
+    Quat* out_rots,
+    Vec3* out_trans,
+    size_t n_out
+);
 
-RETURN_STATUS String_Append(String* str, char* start, size_t len) {
-    if (String_CheckCapacity(str, len) != SUCCESS) {
-        return FAILURE;
-    }
-    memcpy(&str->begin[str->size], start, len);
-    str->size += len;
-    return SUCCESS;
+f32 F32_Abs(f32 value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits &= 0x7FFFFFFF;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
 }
 
-RETURN_STATUS String_AppendStr(String* str, const char* input_str) {
-    int str_len = strlen(input_str);
-    if (String_CheckCapacity(str, str_len) != SUCCESS) {
-        return FAILURE;
-    }
-    memcpy(&str->begin[str->size], input_str, str_len);
-    str->size += str_len;
-    return SUCCESS;
+#ifdef TYPES_SIMD_SSE2
+static inline __m128 Vec4_Load(const Vec4* vec) {
+    return _mm_loadu_ps((const f32*)vec);
 }
 
-RETURN_STATUS String_AppendMany(String* str, ...) {
-    va_list args;
-    va_start(args, str);
-    const char* append_str;
-    while ((append_str = va_arg(args, const char*)) != NULL) {
-        if (String_AppendStr(str, append_str) != SUCCESS) {
-            return FAILURE;
-        }
-    }
-    return SUCCESS;
+static inline Vec4 Vec4_Store(__m128 reg) {
+    Vec4 vec;
+    _mm_storeu_ps((f32*)&vec, reg);
+    return vec;
 }
 
-RETURN_STATUS String_AppendVec3(String* str, Vec3 vec) {
-    char local_buf[VEC_MAX_WRITE] = {0};
-    size_t written = snprintf(
-        local_buf, VEC_MAX_WRITE, "[%9.4f, %9.4f, %9.4f]", vec.x, vec.y, vec.z
-    );
-    if (String_Append(str, local_buf, written) != SUCCESS) {
-        return FAILURE;
-    }
-    return SUCCESS;
+/* Sum of all four lanes, broadcast to every lane */
+static inline __m128 M128_HorizontalSum(__m128 reg) {
+    __m128 shuf = _mm_shuffle_ps(reg, reg, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(reg, shuf);
+    shuf = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm_add_ps(sums, shuf);
 }
 
-RETURN_STATUS String_AppendVec4(String* str, Vec4 vec) {
-    char local_buf[VEC_MAX_WRITE] = {0};
-    int written = snprintf(
-        local_buf,
-        VEC_MAX_WRITE,
-        "[%9.4f, %9.4f, %9.4f, %9.4f]",
-        vec.x,
-        vec.y,
-        vec.z,
-        vec.w
-    );
-    if (String_Append(str, local_buf, written) != SUCCESS) {
-        return FAILURE;
-    }
-    return SUCCESS;
-}
-
-RETURN_STATUS String_AppendMat4(String* str, Mat4 mat) {
-    if (String_AppendStr(str, "[\n\t") != SUCCESS) {
-        return FAILURE;
-    }
-    Vec4* row_ptr = (Vec4*)&mat;
-    size_t n_rows = 4;
-    for (size_t i = 0; i < n_rows; ++i) {
-        if (String_AppendVec4(str, row_ptr[i]) != SUCCESS) {
-            return FAILURE;
-        }
-        if (String_AppendStr(str, "\n") != SUCCESS) {
-            return FAILURE;
-        }
-        if (i != n_rows - 1) {
-            if (String_AppendStr(str, "\t") != SUCCESS) {
-                return FAILURE;
-            }
-        }
-    }
-    if (String_AppendStr(str, "]\n") != SUCCESS) {
-        return FAILURE;
-    }
-    return SUCCESS;
-}
-
-RETURN_STATUS String_CheckCapacity(String* str, size_t len) {
-    while (str->size + len > str->capacity) {
-        int new_capacity = str->capacity * 2;
-        str->begin = (char*)realloc(str->begin, new_capacity);
-        if (NULL == str->begin) {
-            fprintf(stderr, "ERROR: failed to reallocate String");
-            return FAILURE;
-        }
-        str->capacity = new_capacity;
-    }
-    return SUCCESS;
-}
-
-f32 F32_Abs(f32 value) {
-    u32* ptr = (u32*)&value;
-    return (*ptr & 0x7FFFFFFF);
+/* Lane mask set where |a - b| > EPSILON */
+static inline __m128 M128_NotEqualMask(__m128 a, __m128 b) {
+    __m128 delta = _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(a, b));
+    return _mm_cmpgt_ps(delta, _mm_set1_ps((f32)EPSILON));
 }
+#endif
 
 bool Vec3_IsEqual(Vec3 a, Vec3 b) {
     f32* col_ptr_a = (f32*)&a;
@@ -296,6 +193,10 @@ Vec3 Vec3_Reject(Vec3 src, Vec3 dst) {
 }
 
 bool Vec4_IsEqual(Vec4 a, Vec4 b) {
+#ifdef TYPES_SIMD_SSE2
+    __m128 mask = M128_NotEqualMask(Vec4_Load(&a), Vec4_Load(&b));
+    return _mm_movemask_ps(mask) == 0;
+#else
     f32* col_ptr_a = (f32*)&a;
     f32* col_ptr_b = (f32*)&b;
     for (size_t col = 0; col < 4; ++col) {
@@ -305,26 +206,48 @@ bool Vec4_IsEqual(Vec4 a, Vec4 b) {
         }
     }
     return true;
+#endif
 }
 
 f32 Vec4_Dot(Vec4 a, Vec4 b) {
+#ifdef TYPES_SIMD_SSE2
+    __m128 prod = _mm_mul_ps(Vec4_Load(&a), Vec4_Load(&b));
+    return _mm_cvtss_f32(M128_HorizontalSum(prod));
+#else
     return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+#endif
 }
 
 Vec4 Vec4_Scale(Vec4 vec, f32 scale) {
+#ifdef TYPES_SIMD_SSE2
+    return Vec4_Store(_mm_mul_ps(Vec4_Load(&vec), _mm_set1_ps(scale)));
+#else
     return (Vec4){
         .x = vec.x * scale,
         .y = vec.y * scale,
         .z = vec.z * scale,
         .w = vec.w * scale,
     };
+#endif
 }
 
 f32 Vec4_Mag(Vec4 vec) {
+#ifdef TYPES_SIMD_SSE2
+    return sqrtf(Vec4_Dot(vec, vec));
+#else
     return sqrtf(vec.x * vec.x + vec.y * vec.y + vec.z * vec.z + vec.w * vec.w);
+#endif
 }
 
-Vec4 Vec4_Normalize(Vec4 vec) { return Vec4_Scale(vec, 1.0f / Vec4_Mag(vec)); }
+Vec4 Vec4_Normalize(Vec4 vec) {
+#ifdef TYPES_SIMD_SSE2
+    __m128 reg = Vec4_Load(&vec);
+    __m128 mag = _mm_sqrt_ps(M128_HorizontalSum(_mm_mul_ps(reg, reg)));
+    return Vec4_Store(_mm_div_ps(reg, mag));
+#else
+    return Vec4_Scale(vec, 1.0f / Vec4_Mag(vec));
+#endif
+}
 
 bool Mat3_IsEqual(Mat3 a, Mat3 b) {
     Vec4* row_ptr_a = (Vec4*)&a;
@@ -360,7 +283,110 @@ Mat3 Mat3_Orthonormalize(Mat3 mat) {
     };
 }
 
+/*
+ * Rodrigues formula, R = cos(t) I + B r r^T + A [r]x with t = |r|,
+ * A = sin(t) / t and B = (1 - cos(t)) / t^2.  Both coefficients are built
+ * from the half angle so neither cancels for small rotations.
+ */
+Mat3 Mat3_FromRotVec(Vec3 rvec) {
+    f32 theta = Vec3_Mag(rvec);
+    if (theta < 1e-12f) {
+        theta = 1e-12f;
+    }
+    f32 half_sin = sinf(0.5f * theta);
+    f32 half_cos = cosf(0.5f * theta);
+    f32 cos_t = 1.0f - 2.0f * half_sin * half_sin;
+    f32 a = 2.0f * half_sin * half_cos / theta;
+    f32 b = 2.0f * half_sin * half_sin / (theta * theta);
+    f32 x = rvec.x;
+    f32 y = rvec.y;
+    f32 z = rvec.z;
+    return (Mat3){
+        .x_row = {cos_t + b * x * x, b * x * y - a * z, b * x * z + a * y},
+        .y_row = {b * x * y + a * z, cos_t + b * y * y, b * y * z - a * x},
+        .z_row = {b * x * z - a * y, b * y * z + a * x, cos_t + b * z * z},
+    };
+}
+
+/*
+ * Inverse Rodrigues.  The angle comes from atan2 of the antisymmetric and
+ * trace parts, which stays accurate near 0.  Past 120 degrees the
+ * antisymmetric part shrinks towards zero, so the axis is recovered from
+ * the symmetric part instead.
+ */
+Vec3 Mat3_ToRotVec(Mat3 rot) {
+    Vec3 sin_axis = {
+        .x = 0.5f * (rot.z_row.y - rot.y_row.z),
+        .y = 0.5f * (rot.x_row.z - rot.z_row.x),
+        .z = 0.5f * (rot.y_row.x - rot.x_row.y),
+    };
+    f32 cos_t = 0.5f * (rot.x_row.x + rot.y_row.y + rot.z_row.z - 1.0f);
+    if (cos_t > 1.0f) cos_t = 1.0f;
+    if (cos_t < -1.0f) cos_t = -1.0f;
+    f32 sin_t = Vec3_Mag(sin_axis);
+    f32 theta = atan2f(sin_t, cos_t);
+
+    if (cos_t > -0.5f) {
+        // t / sin(t) -> 1 as t -> 0
+        f32 scale = sin_t > 1e-12f ? theta / sin_t : 1.0f;
+        return Vec3_Scale(sin_axis, scale);
+    }
+
+    // R = cos(t) I + (1 - cos(t)) n n^T + sin(t) [n]x; use the largest
+    // diagonal entry of n n^T to avoid dividing by a small component
+    f32 one_minus_cos = 1.0f - cos_t;
+    f32 diag[3] = {rot.x_row.x, rot.y_row.y, rot.z_row.z};
+    Vec3 axis;
+    if (diag[0] >= diag[1] && diag[0] >= diag[2]) {
+        axis.x = sqrtf(fmaxf((diag[0] - cos_t) / one_minus_cos, 0.0f));
+        axis.y = (rot.x_row.y + rot.y_row.x) / (2.0f * one_minus_cos * axis.x);
+        axis.z = (rot.x_row.z + rot.z_row.x) / (2.0f * one_minus_cos * axis.x);
+    } else if (diag[1] >= diag[2]) {
+        axis.y = sqrtf(fmaxf((diag[1] - cos_t) / one_minus_cos, 0.0f));
+        axis.x = (rot.x_row.y + rot.y_row.x) / (2.0f * one_minus_cos * axis.y);
+        axis.z = (rot.y_row.z + rot.z_row.y) / (2.0f * one_minus_cos * axis.y);
+    } else {
+        axis.z = sqrtf(fmaxf((diag[2] - cos_t) / one_minus_cos, 0.0f));
+        axis.x = (rot.x_row.z + rot.z_row.x) / (2.0f * one_minus_cos * axis.z);
+        axis.y = (rot.y_row.z + rot.z_row.y) / (2.0f * one_minus_cos * axis.z);
+    }
+    if (Vec3_Dot(axis, sin_axis) < 0.0f) {
+        axis = Vec3_Scale(axis, -1.0f);
+    }
+    return Vec3_Scale(Vec3_Normalize(axis), theta);
+}
+
 bool Mat4_IsEqual(Mat4 a, Mat4 b) {
+#if defined(TYPES_SIMD_AVX2)
+    const f32* ptr_a = (const f32*)&a;
+    const f32* ptr_b = (const f32*)&b;
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 eps = _mm256_set1_ps((f32)EPSILON);
+    __m256 delta_lo = _mm256_andnot_ps(
+        sign, _mm256_sub_ps(_mm256_loadu_ps(ptr_a), _mm256_loadu_ps(ptr_b))
+    );
+    __m256 delta_hi = _mm256_andnot_ps(
+        sign,
+        _mm256_sub_ps(_mm256_loadu_ps(ptr_a + 8), _mm256_loadu_ps(ptr_b + 8))
+    );
+    __m256 mask = _mm256_or_ps(
+        _mm256_cmp_ps(delta_lo, eps, _CMP_GT_OQ),
+        _mm256_cmp_ps(delta_hi, eps, _CMP_GT_OQ)
+    );
+    return _mm256_movemask_ps(mask) == 0;
+#elif defined(TYPES_SIMD_SSE2)
+    __m128 mask = _mm_or_ps(
+        _mm_or_ps(
+            M128_NotEqualMask(Vec4_Load(&a.x_row), Vec4_Load(&b.x_row)),
+            M128_NotEqualMask(Vec4_Load(&a.y_row), Vec4_Load(&b.y_row))
+        ),
+        _mm_or_ps(
+            M128_NotEqualMask(Vec4_Load(&a.z_row), Vec4_Load(&b.z_row)),
+            M128_NotEqualMask(Vec4_Load(&a.w_row), Vec4_Load(&b.w_row))
+        )
+    );
+    return _mm_movemask_ps(mask) == 0;
+#else
     Vec4* row_ptr_a = (Vec4*)&a;
     Vec4* row_ptr_b = (Vec4*)&b;
     for (size_t row = 0; row < 4; ++row) {
@@ -374,9 +400,23 @@ bool Mat4_IsEqual(Mat4 a, Mat4 b) {
         }
     }
     return true;
+#endif
 }
 
 Mat4 Mat4_Transpose(Mat4 mat) {
+#ifdef TYPES_SIMD_SSE2
+    __m128 row0 = Vec4_Load(&mat.x_row);
+    __m128 row1 = Vec4_Load(&mat.y_row);
+    __m128 row2 = Vec4_Load(&mat.z_row);
+    __m128 row3 = Vec4_Load(&mat.w_row);
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    return (Mat4){
+        .x_row = Vec4_Store(row0),
+        .y_row = Vec4_Store(row1),
+        .z_row = Vec4_Store(row2),
+        .w_row = Vec4_Store(row3),
+    };
+#else
     return (Mat4){
         .x_row =
             {
@@ -407,6 +447,468 @@ Mat4 Mat4_Transpose(Mat4 mat) {
                 .w = mat.w_row.w,
             },
     };
+#endif
+}
+
+Mat4 Mat4_Identity(void) {
+    return (Mat4){
+        .x_row = {1.0f, 0.0f, 0.0f, 0.0f},
+        .y_row = {0.0f, 1.0f, 0.0f, 0.0f},
+        .z_row = {0.0f, 0.0f, 1.0f, 0.0f},
+        .w_row = {0.0f, 0.0f, 0.0f, 1.0f},
+    };
+}
+
+/* Rigid transform that rotates by `rot` and then translates by `trans` */
+Mat4 Mat4_Affine(Mat3 rot, Vec3 trans) {
+    return (Mat4){
+        .x_row = {rot.x_row.x, rot.x_row.y, rot.x_row.z, trans.x},
+        .y_row = {rot.y_row.x, rot.y_row.y, rot.y_row.z, trans.y},
+        .z_row = {rot.z_row.x, rot.z_row.y, rot.z_row.z, trans.z},
+        .w_row = {0.0f, 0.0f, 0.0f, 1.0f},
+    };
+}
+
+Mat4 Mat4_FromPose(Pose pose) {
+    return Mat4_Affine(Mat3_FromRotVec(pose.rvec), pose.tvec);
+}
+
+#ifdef TYPES_SIMD_SSE2
+/* One row of a * b: the rows of b weighted by the entries of `a_row` */
+static inline __m128 M128_MulRow(
+    __m128 a_row, __m128 b0, __m128 b1, __m128 b2, __m128 b3
+) {
+    __m128 sum = _mm_mul_ps(_mm_shuffle_ps(a_row, a_row, 0x00), b0);
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(a_row, a_row, 0x55), b1));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(a_row, a_row, 0xAA), b2));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(a_row, a_row, 0xFF), b3));
+    return sum;
+}
+
+static inline void Mat4_MulSse(const f32* a, const f32* b, f32* out) {
+    __m128 b0 = _mm_loadu_ps(b);
+    __m128 b1 = _mm_loadu_ps(b + 4);
+    __m128 b2 = _mm_loadu_ps(b + 8);
+    __m128 b3 = _mm_loadu_ps(b + 12);
+    __m128 r0 = M128_MulRow(_mm_loadu_ps(a), b0, b1, b2, b3);
+    __m128 r1 = M128_MulRow(_mm_loadu_ps(a + 4), b0, b1, b2, b3);
+    __m128 r2 = M128_MulRow(_mm_loadu_ps(a + 8), b0, b1, b2, b3);
+    __m128 r3 = M128_MulRow(_mm_loadu_ps(a + 12), b0, b1, b2, b3);
+    _mm_storeu_ps(out, r0);
+    _mm_storeu_ps(out + 4, r1);
+    _mm_storeu_ps(out + 8, r2);
+    _mm_storeu_ps(out + 12, r3);
+}
+#endif
+
+#ifdef TYPES_SIMD_AVX2
+/* Two rows of a * b at once; each 128-bit lane holds one row of `a_rows` */
+static inline __m256 M256_MulRows(
+    __m256 a_rows, __m256 b0, __m256 b1, __m256 b2, __m256 b3
+) {
+    __m256 sum = _mm256_mul_ps(_mm256_permute_ps(a_rows, 0x00), b0);
+    sum = _mm256_add_ps(
+        sum, _mm256_mul_ps(_mm256_permute_ps(a_rows, 0x55), b1)
+    );
+    sum = _mm256_add_ps(
+        sum, _mm256_mul_ps(_mm256_permute_ps(a_rows, 0xAA), b2)
+    );
+    sum = _mm256_add_ps(
+        sum, _mm256_mul_ps(_mm256_permute_ps(a_rows, 0xFF), b3)
+    );
+    return sum;
+}
+#endif
+
+Mat4 Mat4_Mul(Mat4 a, Mat4 b) {
+    Mat4 out;
+#ifdef TYPES_SIMD_SSE2
+    Mat4_MulSse((const f32*)&a, (const f32*)&b, (f32*)&out);
+#else
+    const f32* ptr_a = (const f32*)&a;
+    const f32* ptr_b = (const f32*)&b;
+    f32* ptr_out = (f32*)&out;
+    for (size_t row = 0; row < 4; ++row) {
+        for (size_t col = 0; col < 4; ++col) {
+            ptr_out[row * 4 + col] = ptr_a[row * 4 + 0] * ptr_b[0 + col] +
+                                     ptr_a[row * 4 + 1] * ptr_b[4 + col] +
+                                     ptr_a[row * 4 + 2] * ptr_b[8 + col] +
+                                     ptr_a[row * 4 + 3] * ptr_b[12 + col];
+        }
+    }
+#endif
+    return out;
+}
+
+Vec4 Mat4_MulVec4(Mat4 mat, Vec4 vec) {
+#ifdef TYPES_SIMD_SSE2
+    __m128 v = Vec4_Load(&vec);
+    __m128 p0 = _mm_mul_ps(Vec4_Load(&mat.x_row), v);
+    __m128 p1 = _mm_mul_ps(Vec4_Load(&mat.y_row), v);
+    __m128 p2 = _mm_mul_ps(Vec4_Load(&mat.z_row), v);
+    __m128 p3 = _mm_mul_ps(Vec4_Load(&mat.w_row), v);
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    return Vec4_Store(_mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3)));
+#else
+    return (Vec4){
+        .x = Vec4_Dot(mat.x_row, vec),
+        .y = Vec4_Dot(mat.y_row, vec),
+        .z = Vec4_Dot(mat.z_row, vec),
+        .w = Vec4_Dot(mat.w_row, vec),
+    };
+#endif
+}
+
+/* General inverse by cofactor expansion.  Fails for singular matrices. */
+RETURN_STATUS Mat4_Inverse(Mat4 mat, Mat4* inv) {
+    const f32* m = (const f32*)&mat;
+    f32 c[16];
+    c[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] -
+           m[9] * m[6] * m[15] + m[9] * m[7] * m[14] +
+           m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    c[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] +
+           m[8] * m[6] * m[15] - m[8] * m[7] * m[14] -
+           m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    c[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] -
+           m[8] * m[5] * m[15] + m[8] * m[7] * m[13] +
+           m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    c[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] +
+            m[8] * m[5] * m[14] - m[8] * m[6] * m[13] -
+            m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    c[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] +
+           m[9] * m[2] * m[15] - m[9] * m[3] * m[14] -
+           m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    c[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] -
+           m[8] * m[2] * m[15] + m[8] * m[3] * m[14] +
+           m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    c[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] +
+           m[8] * m[1] * m[15] - m[8] * m[3] * m[13] -
+           m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    c[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] -
+            m[8] * m[1] * m[14] + m[8] * m[2] * m[13] +
+            m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    c[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] -
+           m[5] * m[2] * m[15] + m[5] * m[3] * m[14] +
+           m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    c[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] +
+           m[4] * m[2] * m[15] - m[4] * m[3] * m[14] -
+           m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    c[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] -
+            m[4] * m[1] * m[15] + m[4] * m[3] * m[13] +
+            m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    c[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] +
+            m[4] * m[1] * m[14] - m[4] * m[2] * m[13] -
+            m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    c[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] +
+           m[5] * m[2] * m[11] - m[5] * m[3] * m[10] -
+           m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    c[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] -
+           m[4] * m[2] * m[11] + m[4] * m[3] * m[10] +
+           m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    c[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] +
+            m[4] * m[1] * m[11] - m[4] * m[3] * m[9] -
+            m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    c[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] -
+            m[4] * m[1] * m[10] + m[4] * m[2] * m[9] +
+            m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    f32 det = m[0] * c[0] + m[1] * c[4] + m[2] * c[8] + m[3] * c[12];
+    if (F32_Abs(det) < EPSILON) {
+        return FAILURE;
+    }
+    f32 inv_det = 1.0f / det;
+    f32* out = (f32*)inv;
+    for (size_t i = 0; i < 16; ++i) {
+        out[i] = c[i] * inv_det;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Inverse of a matrix whose last row is [0, 0, 0, 1].  Much cheaper than
+ * Mat4_Inverse; for rigid poses the linear part reduces to a transpose.
+ */
+RETURN_STATUS Mat4_AffineInverse(Mat4 mat, Mat4* inv) {
+    Vec3 r0 = {mat.x_row.x, mat.x_row.y, mat.x_row.z};
+    Vec3 r1 = {mat.y_row.x, mat.y_row.y, mat.y_row.z};
+    Vec3 r2 = {mat.z_row.x, mat.z_row.y, mat.z_row.z};
+    Vec3 trans = {mat.x_row.w, mat.y_row.w, mat.z_row.w};
+
+    // Columns of the inverse linear part are the cross products of its rows
+    Vec3 c0 = Vec3_Cross(r1, r2);
+    Vec3 c1 = Vec3_Cross(r2, r0);
+    Vec3 c2 = Vec3_Cross(r0, r1);
+    f32 det = Vec3_Dot(r0, c0);
+    if (F32_Abs(det) < EPSILON) {
+        return FAILURE;
+    }
+    f32 inv_det = 1.0f / det;
+    Mat3 rot = {
+        .x_row = {c0.x * inv_det, c1.x * inv_det, c2.x * inv_det},
+        .y_row = {c0.y * inv_det, c1.y * inv_det, c2.y * inv_det},
+        .z_row = {c0.z * inv_det, c1.z * inv_det, c2.z * inv_det},
+    };
+    *inv = Mat4_Affine(rot, Vec3_Scale(Vec3_Rotate(trans, rot), -1.0f));
+    return SUCCESS;
+}
+
+/* out[i] = a[i] * b[i] for i in [0, n).  `out` may alias `a` or `b`. */
+void Mat4_MulBatch(const Mat4* a, const Mat4* b, Mat4* out, size_t n) {
+    size_t i = 0;
+#if defined(TYPES_SIMD_AVX2)
+    for (; i + 2 <= n; i += 2) {
+        const f32* pa0 = (const f32*)&a[i];
+        const f32* pb0 = (const f32*)&b[i];
+        const f32* pa1 = (const f32*)&a[i + 1];
+        const f32* pb1 = (const f32*)&b[i + 1];
+        __m256 b00 = _mm256_broadcast_ps((const __m128*)pb0);
+        __m256 b01 = _mm256_broadcast_ps((const __m128*)(pb0 + 4));
+        __m256 b02 = _mm256_broadcast_ps((const __m128*)(pb0 + 8));
+        __m256 b03 = _mm256_broadcast_ps((const __m128*)(pb0 + 12));
+        __m256 b10 = _mm256_broadcast_ps((const __m128*)pb1);
+        __m256 b11 = _mm256_broadcast_ps((const __m128*)(pb1 + 4));
+        __m256 b12 = _mm256_broadcast_ps((const __m128*)(pb1 + 8));
+        __m256 b13 = _mm256_broadcast_ps((const __m128*)(pb1 + 12));
+        __m256 r00 =
+            M256_MulRows(_mm256_loadu_ps(pa0), b00, b01, b02, b03);
+        __m256 r01 =
+            M256_MulRows(_mm256_loadu_ps(pa0 + 8), b00, b01, b02, b03);
+        __m256 r10 =
+            M256_MulRows(_mm256_loadu_ps(pa1), b10, b11, b12, b13);
+        __m256 r11 =
+            M256_MulRows(_mm256_loadu_ps(pa1 + 8), b10, b11, b12, b13);
+        f32* po0 = (f32*)&out[i];
+        f32* po1 = (f32*)&out[i + 1];
+        _mm256_storeu_ps(po0, r00);
+        _mm256_storeu_ps(po0 + 8, r01);
+        _mm256_storeu_ps(po1, r10);
+        _mm256_storeu_ps(po1 + 8, r11);
+    }
+#elif defined(TYPES_SIMD_SSE2)
+    for (; i + 2 <= n; i += 2) {
+        Mat4_MulSse((const f32*)&a[i], (const f32*)&b[i], (f32*)&out[i]);
+        Mat4_MulSse(
+            (const f32*)&a[i + 1], (const f32*)&b[i + 1], (f32*)&out[i + 1]
+        );
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = Mat4_Mul(a[i], b[i]);
+    }
+}
+
+Quat Quat_Identity(void) { return (Quat){0.0f, 0.0f, 0.0f, 1.0f}; }
+
+/* Hamilton product; applying the result rotates by b first, then a */
+Quat Quat_Mul(Quat a, Quat b) {
+    return (Quat){
+        .x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        .y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        .z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        .w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+    };
+}
+
+Quat Quat_Conjugate(Quat quat) {
+    return (Quat){-quat.x, -quat.y, -quat.z, quat.w};
+}
+
+Quat Quat_Normalize(Quat quat) {
+    Vec4 vec = Vec4_Normalize((Vec4){quat.x, quat.y, quat.z, quat.w});
+    return (Quat){vec.x, vec.y, vec.z, vec.w};
+}
+
+/* v + 2w (u x v) + 2 u x (u x v), cheaper than building the matrix */
+Vec3 Quat_RotateVec3(Quat quat, Vec3 vec) {
+    Vec3 u = {quat.x, quat.y, quat.z};
+    Vec3 uv = Vec3_Cross(u, vec);
+    Vec3 uuv = Vec3_Cross(u, uv);
+    return Vec3_Add(
+        vec, Vec3_Add(Vec3_Scale(uv, 2.0f * quat.w), Vec3_Scale(uuv, 2.0f))
+    );
+}
+
+Quat Quat_FromRotVec(Vec3 rvec) {
+    f32 theta = Vec3_Mag(rvec);
+    f32 half = 0.5f * theta;
+    // sin(t / 2) / t, with its Taylor series near zero
+    f32 scale = theta > 1e-4f ? sinf(half) / theta
+                              : 0.5f - theta * theta / 48.0f;
+    return (Quat){
+        rvec.x * scale,
+        rvec.y * scale,
+        rvec.z * scale,
+        cosf(half),
+    };
+}
+
+/* Shepperd's method: branch on the largest of w, x, y, z for stability */
+Quat Quat_FromMat3(Mat3 rot) {
+    f32 trace = rot.x_row.x + rot.y_row.y + rot.z_row.z;
+    Quat quat;
+    if (trace > 0.0f) {
+        f32 s = 2.0f * sqrtf(trace + 1.0f);
+        quat.w = 0.25f * s;
+        quat.x = (rot.z_row.y - rot.y_row.z) / s;
+        quat.y = (rot.x_row.z - rot.z_row.x) / s;
+        quat.z = (rot.y_row.x - rot.x_row.y) / s;
+    } else if (rot.x_row.x > rot.y_row.y && rot.x_row.x > rot.z_row.z) {
+        f32 s = 2.0f * sqrtf(1.0f + rot.x_row.x - rot.y_row.y - rot.z_row.z);
+        quat.w = (rot.z_row.y - rot.y_row.z) / s;
+        quat.x = 0.25f * s;
+        quat.y = (rot.x_row.y + rot.y_row.x) / s;
+        quat.z = (rot.x_row.z + rot.z_row.x) / s;
+    } else if (rot.y_row.y > rot.z_row.z) {
+        f32 s = 2.0f * sqrtf(1.0f + rot.y_row.y - rot.x_row.x - rot.z_row.z);
+        quat.w = (rot.x_row.z - rot.z_row.x) / s;
+        quat.x = (rot.x_row.y + rot.y_row.x) / s;
+        quat.y = 0.25f * s;
+        quat.z = (rot.y_row.z + rot.z_row.y) / s;
+    } else {
+        f32 s = 2.0f * sqrtf(1.0f + rot.z_row.z - rot.x_row.x - rot.y_row.y);
+        quat.w = (rot.y_row.x - rot.x_row.y) / s;
+        quat.x = (rot.x_row.z + rot.z_row.x) / s;
+        quat.y = (rot.y_row.z + rot.z_row.y) / s;
+        quat.z = 0.25f * s;
+    }
+    return Quat_Normalize(quat);
+}
+
+Mat3 Quat_ToMat3(Quat quat) {
+    f32 xx = quat.x * quat.x;
+    f32 yy = quat.y * quat.y;
+    f32 zz = quat.z * quat.z;
+    f32 xy = quat.x * quat.y;
+    f32 xz = quat.x * quat.z;
+    f32 yz = quat.y * quat.z;
+    f32 wx = quat.w * quat.x;
+    f32 wy = quat.w * quat.y;
+    f32 wz = quat.w * quat.z;
+    return (Mat3){
+        .x_row = {1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy)},
+        .y_row = {2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx)},
+        .z_row = {2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy)},
+    };
+}
+
+/*
+ * Normalized linear blend along the shorter arc.  Not constant speed, but
+ * a single square root and no trig, and always a valid rotation.
+ */
+Quat Quat_Nlerp(Quat a, Quat b, f32 t) {
+    f32 cos_t =
+        Vec4_Dot((Vec4){a.x, a.y, a.z, a.w}, (Vec4){b.x, b.y, b.z, b.w});
+    f32 wa = 1.0f - t;
+    f32 wb = cos_t < 0.0f ? -t : t;
+    return Quat_Normalize((Quat){
+        wa * a.x + wb * b.x,
+        wa * a.y + wb * b.y,
+        wa * a.z + wb * b.z,
+        wa * a.w + wb * b.w,
+    });
+}
+
+/* Constant angular velocity; falls back to Quat_Nlerp for tiny arcs */
+Quat Quat_Slerp(Quat a, Quat b, f32 t) {
+    f32 cos_t =
+        Vec4_Dot((Vec4){a.x, a.y, a.z, a.w}, (Vec4){b.x, b.y, b.z, b.w});
+    if (cos_t < 0.0f) {
+        cos_t = -cos_t;
+        b = (Quat){-b.x, -b.y, -b.z, -b.w};
+    }
+    if (cos_t > 0.9995f) {
+        return Quat_Nlerp(a, b, t);
+    }
+    f32 theta = acosf(cos_t);
+    f32 inv_sin = 1.0f / sinf(theta);
+    f32 wa = sinf((1.0f - t) * theta) * inv_sin;
+    f32 wb = sinf(t * theta) * inv_sin;
+    return (Quat){
+        wa * a.x + wb * b.x,
+        wa * a.y + wb * b.y,
+        wa * a.z + wb * b.z,
+        wa * a.w + wb * b.w,
+    };
+}
+
+/*
+ * Resample a trajectory of n_keys evenly spaced keyframes to n_out evenly
+ * spaced samples over the same interval.  Rotations are slerped and
+ * translations lerped; `trans` and `out_trans` may both be NULL.  The arc
+ * angle and 1 / sin of each segment are computed once per segment rather
+ * than once per sample.
+ */
+void Quat_ResampleTrajectory(
+    const Quat* rots,
+    const Vec3* trans,
+    size_t n_keys,
+    Quat* out_rots,
+    Vec3* out_trans,
+    size_t n_out
+) {
+    if (n_keys == 0 || n_out == 0) {
+        return;
+    }
+    if (n_keys == 1 || n_out == 1) {
+        for (size_t i = 0; i < n_out; ++i) {
+            out_rots[i] = rots[0];
+            if (trans != NULL) out_trans[i] = trans[0];
+        }
+        return;
+    }
+
+    f32 step = (f32)(n_keys - 1) / (f32)(n_out - 1);
+    size_t segment = (size_t)-1;
+    Quat a = {0};
+    Quat b = {0};
+    f32 theta = 0.0f;
+    f32 inv_sin = 0.0f;
+    bool use_nlerp = false;
+    for (size_t i = 0; i < n_out; ++i) {
+        f32 key_time = (f32)i * step;
+        size_t key = (size_t)key_time;
+        if (key >= n_keys - 1) {
+            key = n_keys - 2;
+        }
+        f32 t = key_time - (f32)key;
+
+        if (key != segment) {
+            segment = key;
+            a = rots[key];
+            b = rots[key + 1];
+            f32 cos_t = Vec4_Dot(
+                (Vec4){a.x, a.y, a.z, a.w}, (Vec4){b.x, b.y, b.z, b.w}
+            );
+            if (cos_t < 0.0f) {
+                cos_t = -cos_t;
+                b = (Quat){-b.x, -b.y, -b.z, -b.w};
+            }
+            use_nlerp = cos_t > 0.9995f;
+            if (!use_nlerp) {
+                theta = acosf(cos_t);
+                inv_sin = 1.0f / sinf(theta);
+            }
+        }
+
+        if (use_nlerp) {
+            out_rots[i] = Quat_Nlerp(a, b, t);
+        } else {
+            f32 wa = sinf((1.0f - t) * theta) * inv_sin;
+            f32 wb = sinf(t * theta) * inv_sin;
+            out_rots[i] = (Quat){
+                wa * a.x + wb * b.x,
+                wa * a.y + wb * b.y,
+                wa * a.z + wb * b.z,
+                wa * a.w + wb * b.w,
+            };
+        }
+        if (trans != NULL) {
+            out_trans[i] = Vec3_Add(
+                Vec3_Scale(trans[key], 1.0f - t),
+                Vec3_Scale(trans[key + 1], t)
+            );
+        }
+    }
 }
 
 #endif /* TYPES_H */
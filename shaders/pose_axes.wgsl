@@ -0,0 +1,39 @@
+struct Camera {
+    view_proj: mat4x4<f32>,
+    axis_length: f32,
+};
+
+@group(0) @binding(0) var<uniform> camera: Camera;
+
+struct VertexInput {
+    @location(0) position: vec3<f32>,
+    @location(1) color: vec3<f32>,
+    // Per instance: the pose as a unit quaternion (scalar last) and translation
+    @location(2) rotation: vec4<f32>,
+    @location(3) translation: vec3<f32>,
+};
+
+struct VertexOutput {
+    @builtin(position) clip_position: vec4<f32>,
+    @location(0) color: vec3<f32>,
+};
+
+fn quat_rotate(q: vec4<f32>, v: vec3<f32>) -> vec3<f32> {
+    let t = 2.0 * cross(q.xyz, v);
+    return v + q.w * t + cross(q.xyz, t);
+}
+
+@vertex
+fn vs_main(model: VertexInput) -> VertexOutput {
+    var out: VertexOutput;
+    let scaled = model.position * camera.axis_length;
+    let world = quat_rotate(model.rotation, scaled) + model.translation;
+    out.color = model.color;
+    out.clip_position = camera.view_proj * vec4<f32>(world, 1.0);
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+    return vec4<f32>(in.color, 1.0);
+}
@@ -1,12 +1,21 @@
+// MAP_ANONYMOUS, MAP_NORESERVE and madvise are not part of strict C99/POSIX
+#define _DEFAULT_SOURCE
+
 #include <assert.h>
 #include <memory.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include "alloc.h"
 
+#ifdef ALLOC_TRACE
+#include <pthread.h>
+#include <signal.h>
+#endif
+
 bool is_power_of_two(uintptr_t x) { return (x & (x - 1)) == 0; }
 
 size_t calc_padding_with_header(
@@ -36,25 +45,61 @@ void Stack_Init(Stack* arena, void* buf, size_t capacity) {
     arena->offset = 0;
 }
 
-void* Stack_AllocAlign(Stack* arena, size_t size, size_t alignment) {
-    assert(is_power_of_two(alignment));
-    if (alignment > 128) {
-        alignment = 128;
+static void* Alloc_Initialise(void* block, size_t size, ALLOC_FLAGS flags) {
+    if (flags & ALLOC_ZERO) {
+        return memset(block, 0, size);
     }
+#ifndef NDEBUG
+    if (flags & ALLOC_POISON) {
+        return memset(block, ALLOC_POISON_BYTE, size);
+    }
+#endif
+    return block;
+}
+
+// Stack_AllocAlignFlags without the out-of-memory report, so Arena can try
+// a block and move on to the next one.
+static void* Stack_TryAllocAlign(
+    Stack* arena, size_t size, size_t alignment, ALLOC_FLAGS flags
+) {
+    assert(is_power_of_two(alignment));
+    // The header sits right after the block so Stack_Pop can find it from
+    // the current offset.
     size_t header_size = sizeof(StackHeader);
     uintptr_t curr_addr = (uintptr_t)arena->buffer + (uintptr_t)arena->offset;
-    size_t padding =
-        calc_padding_with_header(curr_addr, alignment, header_size);
-    if (arena->offset + size + padding >= arena->capacity) {
-        fprintf(stderr, "Out of memory.");
+    size_t padding = calc_padding_with_header(curr_addr, alignment, 0);
+    uintptr_t block_addr = curr_addr + (uintptr_t)padding;
+    uintptr_t header_addr = block_addr + (uintptr_t)size;
+    header_addr += calc_padding_with_header(
+        header_addr, DEFAULT_ALIGNMENT, 0
+    );
+    uintptr_t next_addr = header_addr + (uintptr_t)header_size;
+    size_t total = (size_t)(next_addr - curr_addr);
+    if (arena->offset + total >= arena->capacity) {
         return NULL;
     }
-    uintptr_t next_addr = curr_addr + (uintptr_t)padding + (uintptr_t)size;
-    StackHeader* header = (StackHeader*)(next_addr - header_size);
+    StackHeader* header = (StackHeader*)header_addr;
     header->prev_offset = arena->offset;
-    header->padding = padding - header_size;
-    arena->offset += padding + size;
-    return memset((void*)curr_addr, 0, size);
+    header->padding = padding;
+    arena->offset += total;
+    return Alloc_Initialise((void*)block_addr, size, flags);
+}
+
+void* (Stack_AllocAlignFlags)(
+    Stack* arena, size_t size, size_t alignment, ALLOC_FLAGS flags
+) {
+    size_t offset = arena->offset;
+    void* block = Stack_TryAllocAlign(arena, size, alignment, flags);
+    if (block == NULL) {
+        fprintf(stderr, "Out of memory.");
+        return NULL;
+    }
+    AllocTrace_Record("Stack", arena->offset - offset, 0);
+    return block;
+}
+
+void* (Stack_AllocAlign)(Stack* arena, size_t size, size_t alignment) {
+    return (Stack_AllocAlignFlags)(arena, size, alignment, ALLOC_ZERO);
 }
 
 void Stack_Pop(Stack* arena) {
@@ -63,9 +108,537 @@ void Stack_Pop(Stack* arena) {
     }
     uintptr_t curr_addr = (uintptr_t)arena->buffer + (uintptr_t)arena->offset;
     StackHeader* header = (StackHeader*)(curr_addr - sizeof(StackHeader));
+    AllocTrace_Release(arena->offset - header->prev_offset);
     arena->offset = header->prev_offset;
-    uintptr_t prev_addr =
-        (uintptr_t)arena->buffer + (uintptr_t)header->prev_offset;
-    memset((void*)prev_addr, 0, curr_addr - prev_addr);
 }
 
+size_t Stack_Save(const Stack* arena) { return arena->offset; }
+
+void Stack_Restore(Stack* arena, size_t marker) {
+    assert(marker <= arena->offset);
+    AllocTrace_Release(arena->offset - marker);
+    arena->offset = marker;
+}
+
+void Arena_Init(Arena* arena, size_t initial_block_size) {
+    arena->current = NULL;
+    arena->spare = NULL;
+    arena->next_block_size = initial_block_size < ARENA_MIN_BLOCK_SIZE
+                                 ? ARENA_MIN_BLOCK_SIZE
+                                 : initial_block_size;
+}
+
+static ArenaBlock* Arena_NewBlock(Arena* arena, size_t min_capacity) {
+    ArenaBlock* block = arena->spare;
+    if (block != NULL && block->stack.capacity >= min_capacity) {
+        arena->spare = NULL;
+    } else {
+        size_t capacity = arena->next_block_size;
+        while (capacity < min_capacity) {
+            capacity *= 2;
+        }
+        block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + capacity);
+        if (block == NULL) {
+            return NULL;
+        }
+        Stack_Init(&block->stack, block + 1, capacity);
+        arena->next_block_size = capacity * 2;
+    }
+    block->prev = arena->current;
+    arena->current = block;
+    return block;
+}
+
+// Unlinks the current block, keeping the larger of it and the spare.
+static void Arena_ReleaseBlock(Arena* arena) {
+    ArenaBlock* block = arena->current;
+    arena->current = block->prev;
+    AllocTrace_Release(block->stack.offset);
+    block->stack.offset = 0;
+    if (arena->spare == NULL ||
+        arena->spare->stack.capacity < block->stack.capacity) {
+        free(arena->spare);
+        arena->spare = block;
+    } else {
+        free(block);
+    }
+}
+
+void* (Arena_AllocAlignFlags)(
+    Arena* arena, size_t size, size_t alignment, ALLOC_FLAGS flags
+) {
+    if (arena->current != NULL) {
+        size_t offset = arena->current->stack.offset;
+        void* ptr = Stack_TryAllocAlign(
+            &arena->current->stack, size, alignment, flags
+        );
+        if (ptr != NULL) {
+            AllocTrace_Record("Arena", arena->current->stack.offset - offset, 0);
+            return ptr;
+        }
+    }
+    // Worst case: full alignment padding plus the trailing header, and the
+    // Stack never fills its last byte.
+    size_t needed = size + alignment + DEFAULT_ALIGNMENT +
+                    sizeof(StackHeader) + 1;
+    if (Arena_NewBlock(arena, needed) == NULL) {
+        fprintf(stderr, "Out of memory.");
+        return NULL;
+    }
+    void* ptr =
+        Stack_TryAllocAlign(&arena->current->stack, size, alignment, flags);
+    AllocTrace_Record("Arena", arena->current->stack.offset, 0);
+    return ptr;
+}
+
+void* (Arena_AllocAlign)(Arena* arena, size_t size, size_t alignment) {
+    return (Arena_AllocAlignFlags)(arena, size, alignment, ALLOC_ZERO);
+}
+
+void Arena_Pop(Arena* arena) {
+    if (arena->current == NULL) {
+        return;
+    }
+    Stack_Pop(&arena->current->stack);
+    if (arena->current->stack.offset == 0) {
+        Arena_ReleaseBlock(arena);
+    }
+}
+
+ArenaMarker Arena_Save(const Arena* arena) {
+    ArenaMarker marker = {arena->current, 0};
+    if (arena->current != NULL) {
+        marker.offset = arena->current->stack.offset;
+    }
+    return marker;
+}
+
+void Arena_Restore(Arena* arena, ArenaMarker marker) {
+    while (arena->current != marker.block) {
+        assert(arena->current != NULL && "marker is not in this arena");
+        Arena_ReleaseBlock(arena);
+    }
+    if (arena->current == NULL) {
+        return;
+    }
+    Stack_Restore(&arena->current->stack, marker.offset);
+}
+
+void Arena_Free(Arena* arena) {
+    while (arena->current != NULL) {
+        ArenaBlock* prev = arena->current->prev;
+        AllocTrace_Release(arena->current->stack.offset);
+        free(arena->current);
+        arena->current = prev;
+    }
+    free(arena->spare);
+    arena->spare = NULL;
+}
+
+static __thread Arena scratch_arenas[SCRATCH_ARENA_COUNT];
+
+Scratch Scratch_Begin(Arena* const* conflicts, size_t n_conflicts) {
+    for (size_t i = 0; i < SCRATCH_ARENA_COUNT; ++i) {
+        Arena* arena = &scratch_arenas[i];
+        bool conflict = false;
+        for (size_t j = 0; j < n_conflicts && !conflict; ++j) {
+            conflict = conflicts[j] == arena;
+        }
+        if (conflict) {
+            continue;
+        }
+        if (arena->next_block_size == 0) {
+            Arena_Init(arena, SCRATCH_BLOCK_SIZE);
+        }
+        return (Scratch){arena, Arena_Save(arena)};
+    }
+    assert(false && "Every scratch arena is in the conflict list");
+    return (Scratch){0};
+}
+
+void Scratch_End(Scratch scratch) {
+    if (scratch.arena != NULL) {
+        Arena_Restore(scratch.arena, scratch.marker);
+    }
+}
+
+void Scratch_ReleaseThread(void) {
+    for (size_t i = 0; i < SCRATCH_ARENA_COUNT; ++i) {
+        Arena_Free(&scratch_arenas[i]);
+        scratch_arenas[i].next_block_size = 0;
+    }
+}
+
+bool VirtualStack_Init(VirtualStack* arena, size_t reserve) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    reserve = (reserve + page_size - 1) & ~(page_size - 1);
+    void* base = mmap(
+        NULL,
+        reserve,
+        PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+        -1,
+        0
+    );
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        memset(arena, 0, sizeof(*arena));
+        return false;
+    }
+    arena->base = (uint8_t*)base;
+    arena->offset = 0;
+    arena->last_offset = 0;
+    arena->committed = 0;
+    arena->reserved = reserve;
+    return true;
+}
+
+// Makes [0, end) readable and writable, rounded up to whole commit chunks.
+static bool VirtualStack_Commit(VirtualStack* arena, size_t end) {
+    if (end <= arena->committed) {
+        return true;
+    }
+    if (end > arena->reserved) {
+        fprintf(stderr, "Out of memory.");
+        return false;
+    }
+    size_t commit = (end + VIRTUAL_STACK_COMMIT_SIZE - 1) &
+                    ~(VIRTUAL_STACK_COMMIT_SIZE - 1);
+    if (commit > arena->reserved) {
+        commit = arena->reserved;
+    }
+    if (mprotect(
+            arena->base + arena->committed,
+            commit - arena->committed,
+            PROT_READ | PROT_WRITE
+        ) != 0) {
+        perror("mprotect");
+        return false;
+    }
+    arena->committed = commit;
+    return true;
+}
+
+void* (VirtualStack_AllocAlign)(VirtualStack* arena, size_t size, size_t alignment) {
+    assert(is_power_of_two(alignment));
+    uintptr_t curr_addr = (uintptr_t)arena->base + (uintptr_t)arena->offset;
+    size_t start = arena->offset + calc_padding_with_header(curr_addr, alignment, 0);
+    if (size > arena->reserved - start ||
+        !VirtualStack_Commit(arena, start + size)) {
+        return NULL;
+    }
+    AllocTrace_Record("VirtualStack", start + size - arena->offset, 0);
+    arena->last_offset = start;
+    arena->offset = start + size;
+    return arena->base + start;
+}
+
+void* (VirtualStack_Grow)(
+    VirtualStack* arena, void* ptr, size_t new_size, size_t alignment
+) {
+    if (ptr == NULL) {
+        return (VirtualStack_AllocAlign)(arena, new_size, alignment);
+    }
+    assert(
+        (uint8_t*)ptr == arena->base + arena->last_offset &&
+        "Only the most recent allocation can grow"
+    );
+    if (new_size > arena->reserved - arena->last_offset ||
+        !VirtualStack_Commit(arena, arena->last_offset + new_size)) {
+        return NULL;
+    }
+    // Growing in place never copies; shrinking shows up as a release
+    size_t offset = arena->last_offset + new_size;
+    if (offset >= arena->offset) {
+        AllocTrace_Record("VirtualStack", offset - arena->offset, 0);
+    } else {
+        AllocTrace_Release(arena->offset - offset);
+    }
+    arena->offset = offset;
+    return ptr;
+}
+
+size_t VirtualStack_Save(const VirtualStack* arena) { return arena->offset; }
+
+void VirtualStack_Restore(VirtualStack* arena, size_t marker) {
+    assert(marker <= arena->offset);
+    AllocTrace_Release(arena->offset - marker);
+    arena->offset = marker;
+    arena->last_offset = marker;
+}
+
+void VirtualStack_Reset(VirtualStack* arena) {
+    if (arena->committed > 0) {
+        // DONTNEED frees the pages now; PROT_NONE makes stale pointers fault
+        madvise(arena->base, arena->committed, MADV_DONTNEED);
+        mprotect(arena->base, arena->committed, PROT_NONE);
+    }
+    AllocTrace_Release(arena->offset);
+    arena->offset = 0;
+    arena->last_offset = 0;
+    arena->committed = 0;
+}
+
+void VirtualStack_Release(VirtualStack* arena) {
+    if (arena->base != NULL) {
+        munmap(arena->base, arena->reserved);
+    }
+    AllocTrace_Release(arena->offset);
+    memset(arena, 0, sizeof(*arena));
+}
+
+bool (Pool_Init)(
+    Pool* pool, Stack* backing, size_t slot_size, size_t alignment,
+    size_t capacity
+) {
+    assert(is_power_of_two(alignment));
+    assert(capacity <= UINT32_MAX && "Pool handles use 32-bit indices");
+    memset(pool, 0, sizeof(*pool));
+    if (alignment < sizeof(PoolSlot)) {
+        alignment = sizeof(PoolSlot);
+    }
+    if (slot_size < sizeof(PoolSlot)) {
+        slot_size = sizeof(PoolSlot);
+    }
+    slot_size = (slot_size + alignment - 1) & ~(alignment - 1);
+    pool->slots =
+        (uint8_t*)(Stack_AllocAlign)(backing, slot_size * capacity, alignment);
+    pool->generations = (uint32_t*)(Stack_AllocAlign)(
+        backing, sizeof(uint32_t) * capacity, sizeof(uint32_t)
+    );
+    if (pool->slots == NULL || pool->generations == NULL) {
+        return false;
+    }
+    pool->slot_size = slot_size;
+    pool->capacity = capacity;
+    return true;
+}
+
+static size_t Pool_IndexOf(const Pool* pool, const void* ptr) {
+    uintptr_t offset = (uintptr_t)ptr - (uintptr_t)pool->slots;
+    assert((uint8_t*)ptr >= pool->slots && "Pointer is not from this pool");
+    assert(offset % pool->slot_size == 0 && "Pointer is not a slot start");
+    size_t index = (size_t)(offset / pool->slot_size);
+    assert(index < pool->next_unused && "Pointer is not from this pool");
+    return index;
+}
+
+void* Pool_Alloc(Pool* pool) {
+    void* slot = NULL;
+    if (pool->free_list != NULL) {
+        slot = pool->free_list;
+        pool->free_list = pool->free_list->next;
+    } else if (pool->next_unused < pool->capacity) {
+        slot = &pool->slots[pool->next_unused * pool->slot_size];
+        pool->next_unused += 1;
+    } else {
+        fprintf(stderr, "Out of memory.");
+        return NULL;
+    }
+    // Odd generations are live, even ones are free
+    pool->generations[Pool_IndexOf(pool, slot)] += 1;
+    pool->used += 1;
+    if (pool->used > pool->peak) {
+        pool->peak = pool->used;
+    }
+    return memset(slot, 0, pool->slot_size);
+}
+
+void Pool_Free(Pool* pool, void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    size_t index = Pool_IndexOf(pool, ptr);
+    assert((pool->generations[index] & 1) && "Double free of a pool slot");
+    pool->generations[index] += 1;
+    PoolSlot* slot = (PoolSlot*)ptr;
+    slot->next = pool->free_list;
+    pool->free_list = slot;
+    pool->used -= 1;
+}
+
+PoolHandle Pool_AllocHandle(Pool* pool) {
+    PoolHandle handle = {0};
+    void* slot = Pool_Alloc(pool);
+    if (slot != NULL) {
+        handle.index = (uint32_t)Pool_IndexOf(pool, slot);
+        handle.generation = pool->generations[handle.index];
+    }
+    return handle;
+}
+
+void* Pool_Get(const Pool* pool, PoolHandle handle) {
+    if (handle.index >= pool->next_unused ||
+        pool->generations[handle.index] != handle.generation ||
+        (handle.generation & 1) == 0) {
+        return NULL;
+    }
+    return &pool->slots[handle.index * pool->slot_size];
+}
+
+void Pool_FreeHandle(Pool* pool, PoolHandle handle) {
+    void* slot = Pool_Get(pool, handle);
+    assert(slot != NULL && "Stale pool handle");
+    Pool_Free(pool, slot);
+}
+
+PoolStats Pool_GetStats(const Pool* pool) {
+    return (PoolStats){
+        .slot_size = pool->slot_size,
+        .capacity = pool->capacity,
+        .used = pool->used,
+        .peak = pool->peak,
+    };
+}
+
+#ifdef ALLOC_TRACE
+
+typedef struct AllocSite {
+    const char* file;
+    int line;
+    const char* allocator;
+    size_t count;
+    size_t bytes;
+    size_t largest;
+    size_t copied;
+} AllocSite;
+
+static struct {
+    pthread_mutex_t lock;
+    AllocSite sites[ALLOC_TRACE_MAX_SITES];
+    size_t n_sites;
+    size_t live;
+    size_t peak;
+    bool registered;
+} alloc_trace = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static __thread const char* alloc_trace_file;
+static __thread int alloc_trace_line;
+static volatile sig_atomic_t alloc_trace_signalled;
+
+void AllocTrace_Here(const char* file, int line) {
+    alloc_trace_file = file;
+    alloc_trace_line = line;
+}
+
+static void AllocTrace_ReportAtExit(void) { AllocTrace_Report(stderr); }
+
+// Open addressing on (allocator, file, line); allocator names are literals
+// and __FILE__ strings are unique per TU, so pointer identity is enough.
+// Sites past the table share the last slot.
+static AllocSite* AllocTrace_Site(
+    const char* allocator, const char* file, int line
+) {
+    size_t hash = ((uintptr_t)file >> 3) * 31u + (size_t)line;
+    hash = hash * 31u + ((uintptr_t)allocator >> 3);
+    for (size_t probe = 0; probe < ALLOC_TRACE_MAX_SITES - 1; ++probe) {
+        AllocSite* site =
+            &alloc_trace.sites[(hash + probe) % (ALLOC_TRACE_MAX_SITES - 1)];
+        if (site->file == NULL) {
+            site->file = file;
+            site->line = line;
+            site->allocator = allocator;
+            alloc_trace.n_sites += 1;
+            return site;
+        }
+        if (site->file == file && site->line == line &&
+            site->allocator == allocator) {
+            return site;
+        }
+    }
+    AllocSite* overflow = &alloc_trace.sites[ALLOC_TRACE_MAX_SITES - 1];
+    overflow->file = "(other sites)";
+    overflow->allocator = "(mixed)";
+    return overflow;
+}
+
+void AllocTrace_Record(const char* allocator, size_t bytes, size_t copied) {
+    const char* file =
+        alloc_trace_file != NULL ? alloc_trace_file : "(untraced)";
+    pthread_mutex_lock(&alloc_trace.lock);
+    if (!alloc_trace.registered) {
+        alloc_trace.registered = true;
+        atexit(AllocTrace_ReportAtExit);
+    }
+    AllocSite* site = AllocTrace_Site(allocator, file, alloc_trace_line);
+    site->count += 1;
+    site->bytes += bytes;
+    site->copied += copied;
+    if (bytes > site->largest) {
+        site->largest = bytes;
+    }
+    alloc_trace.live += bytes - copied;
+    if (alloc_trace.live > alloc_trace.peak) {
+        alloc_trace.peak = alloc_trace.live;
+    }
+    pthread_mutex_unlock(&alloc_trace.lock);
+
+    if (alloc_trace_signalled) {
+        alloc_trace_signalled = 0;
+        AllocTrace_Report(stderr);
+    }
+}
+
+void AllocTrace_Release(size_t bytes) {
+    pthread_mutex_lock(&alloc_trace.lock);
+    alloc_trace.live = bytes < alloc_trace.live ? alloc_trace.live - bytes : 0;
+    pthread_mutex_unlock(&alloc_trace.lock);
+}
+
+static int AllocTrace_CompareBytes(const void* a, const void* b) {
+    const AllocSite* lhs = (const AllocSite*)a;
+    const AllocSite* rhs = (const AllocSite*)b;
+    if (lhs->bytes != rhs->bytes) {
+        return lhs->bytes < rhs->bytes ? 1 : -1;
+    }
+    return (lhs->count < rhs->count) - (lhs->count > rhs->count);
+}
+
+void AllocTrace_Report(FILE* out) {
+    static AllocSite sorted[ALLOC_TRACE_MAX_SITES];
+    pthread_mutex_lock(&alloc_trace.lock);
+    size_t n = 0;
+    for (size_t i = 0; i < ALLOC_TRACE_MAX_SITES; ++i) {
+        if (alloc_trace.sites[i].count > 0) {
+            sorted[n++] = alloc_trace.sites[i];
+        }
+    }
+    size_t live = alloc_trace.live;
+    size_t peak = alloc_trace.peak;
+    pthread_mutex_unlock(&alloc_trace.lock);
+
+    qsort(sorted, n, sizeof(AllocSite), AllocTrace_CompareBytes);
+    fprintf(
+        out, "Allocation report: %zu sites, %zu bytes live, %zu peak\n", n,
+        live, peak
+    );
+    fprintf(
+        out, "%14s %10s %14s %14s  %-12s %s\n", "bytes", "count", "largest",
+        "copied", "allocator", "site"
+    );
+    for (size_t i = 0; i < n; ++i) {
+        fprintf(
+            out, "%14zu %10zu %14zu %14zu  %-12s %s:%d\n", sorted[i].bytes,
+            sorted[i].count, sorted[i].largest, sorted[i].copied,
+            sorted[i].allocator, sorted[i].file, sorted[i].line
+        );
+    }
+}
+
+// Reporting is not async-signal-safe, so the handler only raises a flag and
+// the next traced allocation prints the report.
+static void AllocTrace_OnSignal(int signo) {
+    (void)signo;
+    alloc_trace_signalled = 1;
+}
+
+void AllocTrace_ReportOnSignal(int signo) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = AllocTrace_OnSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(signo, &action, NULL);
+}
+
+#endif /* ALLOC_TRACE */
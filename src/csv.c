@@ -1,35 +1,76 @@
+// madvise and MADV_* are not part of strict C99/POSIX
+#define _DEFAULT_SOURCE
+
 #include "csv.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-EXIT_STATUS String_Resize(String* str, size_t capacity) {
-    if (str->capacity < capacity) {
-        str->items = (char*)realloc(str->items, capacity);
-        if (str->items == NULL) {
-            fprintf(stderr, "Out of memory\n");
-            return EXIT_ERR;
+/* read() until `size` bytes arrive or EOF; returns bytes read or -1 */
+static ssize_t read_full(int fd, char* buffer, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        ssize_t bytes_read = read(fd, &buffer[total], size - total);
+        if (bytes_read < 0) {
+            if (errno == EINTR) continue;
+            return -1;
         }
-        memset(&str->items[str->size], 0, capacity - str->capacity);
-        str->capacity = capacity;
+        if (bytes_read == 0) break;
+        total += (size_t)bytes_read;
     }
-    return EXIT_OK;
+    return (ssize_t)total;
 }
 
-EXIT_STATUS String_Append(String* str, const char* other, size_t other_size) {
-    // Handle uninitialized
-    if (str->capacity <= 0) {
-        if (String_Resize(str, 64) != EXIT_OK) {
+/*
+ * Read everything left on `fd` into `content`.  The caller owns `fd`;
+ * `info` is its fstat, used to size the buffer for regular files.
+ */
+static EXIT_STATUS String_ReadFd(
+    String* content, int fd, const struct stat* info
+) {
+    content->size = 0;
+    if (S_ISREG(info->st_mode)) {
+        size_t file_size = (size_t)info->st_size;
+        if (String_Reserve(content, file_size) != SUCCESS) {
             return EXIT_ERR;
         }
-        str->size = 0;
-    }
-    while (str->capacity <= str->size + other_size) {
-        if (String_Resize(str, str->capacity * 2) != EXIT_OK) {
+        ssize_t bytes_read = read_full(fd, String_Data(content), file_size);
+        if (bytes_read < 0) {
+            perror("read");
             return EXIT_ERR;
         }
+        content->size = (size_t)bytes_read;
+    } else {
+        // Pipes and character devices have no size up front
+        for (;;) {
+            if (content->capacity - content->size < 4096) {
+                size_t capacity =
+                    content->capacity < 65536 ? 65536 : content->capacity * 2;
+                if (String_Reserve(content, capacity) != SUCCESS) {
+                    return EXIT_ERR;
+                }
+            }
+            size_t available = content->capacity - content->size;
+            ssize_t bytes_read =
+                read_full(fd, &String_Data(content)[content->size], available);
+            if (bytes_read < 0) {
+                perror("read");
+                return EXIT_ERR;
+            }
+            content->size += (size_t)bytes_read;
+            // A short read means EOF
+            if ((size_t)bytes_read < available) {
+                break;
+            }
+        }
+    }
+    if (content->size == 0) {
+        fprintf(stderr, "File was empty.");
+        return EXIT_ERR;
     }
-    memcpy(&str->items[str->size], other, other_size);
-    str->size += other_size;
     return EXIT_OK;
 }
 
@@ -39,80 +80,197 @@ EXIT_STATUS String_ReadFile(String* content, const char* filepath) {
         perror("open");
         return EXIT_ERR;
     }
-    off_t file_size = lseek(fd, 0, SEEK_END);
-    if (file_size < 0) {
-        fprintf(stderr, "Failed to read file.");
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        perror("fstat");
+        close(fd);
         return EXIT_ERR;
     }
-    if (file_size == 0) {
-        fprintf(stderr, "File was empty.");
+    EXIT_STATUS status = String_ReadFd(content, fd, &info);
+    if (close(fd) != 0) {
+        perror("close");
         return EXIT_ERR;
     }
-    lseek(fd, 0, SEEK_SET);
+    return status;
+}
 
-    String_Resize(content, file_size);
-    int bytes_read = read(fd, content->items, file_size);
-    if(close(fd) != 0) {
-        perror("close");
+EXIT_STATUS FileView_Open(FileView* file, const char* filepath) {
+    file->content = (StringView){0};
+    file->mapped = false;
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        perror("open");
         return EXIT_ERR;
     }
-    content->size = file_size;
-    if (bytes_read != file_size) {
-        fprintf(stderr, "Warning: did not read entire file");
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        perror("fstat");
+        close(fd);
         return EXIT_ERR;
     }
-    return EXIT_OK;
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* map =
+            mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            close(fd);
+            // Parsers stream front to back: read ahead aggressively and
+            // let the kernel drop pages behind us.
+            madvise(map, (size_t)info.st_size, MADV_SEQUENTIAL);
+            file->content.start = (char*)map;
+            file->content.length = (size_t)info.st_size;
+            file->mapped = true;
+            return EXIT_OK;
+        }
+    }
+
+    // Pipes can only be read once, so keep using the descriptor we have
+    String buffer = {0};
+    EXIT_STATUS status = String_ReadFd(&buffer, fd, &info);
+    close(fd);
+    if (status != EXIT_OK) {
+        String_Free(&buffer);
+        return EXIT_ERR;
+    }
+    file->content.length = buffer.size;
+    file->content.start = String_Detach(&buffer);
+    return file->content.start != NULL ? EXIT_OK : EXIT_ERR;
+}
+
+void FileView_Close(FileView* file) {
+    if (file == NULL || file->content.start == NULL) {
+        return;
+    }
+    if (file->mapped) {
+        munmap(file->content.start, file->content.length);
+    } else {
+        free(file->content.start);
+    }
+    file->content = (StringView){0};
+    file->mapped = false;
 }
 
 EXIT_STATUS String_Split(String* str, VecString* pieces, const char delim) {
     assert(str != NULL && "Cannot split a NULL String");
-    String* piece = NULL;
-    for (size_t i = 0; i < str->size; ++i) {
-        char c = str->items[i];
-        if (c == delim) {
+    StringView rest = String_View(str);
+    Span spans[256];
+    while (rest.length > 0) {
+        size_t consumed = 0;
+        size_t n_spans = StringView_ScanSpans(
+            rest, delim, spans, sizeof(spans) / sizeof(spans[0]), &consumed
+        );
+        for (size_t i = 0; i < n_spans; ++i) {
             // We don't care about empty lines
-            if (piece != NULL && !String_IsEmpty(piece)) {
-                // Allocate a new string
-                piece = VecString_Alloc(pieces);
-                if (piece == NULL) return EXIT_ERR;
+            if (spans[i].length == 0) continue;
+            String* piece = VecString_Alloc(pieces);
+            if (piece == NULL) return EXIT_ERR;
+            if (String_Append(
+                    piece, &rest.start[spans[i].offset], spans[i].length
+                ) != SUCCESS) {
+                return EXIT_ERR;
             }
-        } else {
-            // Only allocate when needed
-            if (piece == NULL) {
-                piece = VecString_Alloc(pieces);
-                if (piece == NULL) return EXIT_ERR;
-            }
-            String_Append(piece, &c, sizeof(char));
         }
+        rest.start += consumed;
+        rest.length -= consumed;
     }
     return EXIT_OK;
 }
 
-void String_Reset(String* str) {
-    if (str == NULL || str->items == NULL) {
+EXIT_STATUS String_SplitIndex(
+    String* str, LineIndex* pieces, const char delim
+) {
+    assert(str != NULL && "Cannot split a NULL String");
+    return LineIndex_Build(pieces, String_View(str), delim);
+}
+
+static EXIT_STATUS LineIndex_Reserve(LineIndex* index, size_t capacity) {
+    if (index->capacity >= capacity) {
+        return EXIT_OK;
+    }
+    Span* items = (Span*)realloc(index->items, capacity * sizeof(Span));
+    if (items == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_ERR;
+    }
+    AllocTrace_Record(
+        "LineIndex", capacity * sizeof(Span), index->capacity * sizeof(Span)
+    );
+    index->items = items;
+    index->capacity = capacity;
+    return EXIT_OK;
+}
+
+/*
+ * Scans straight into the span array, so building costs one pass over the
+ * source plus a handful of reallocations, whatever the number of lines.
+ */
+EXIT_STATUS (LineIndex_Build)(
+    LineIndex* index, StringView source, const char delim
+) {
+    assert(index != NULL && "Cannot build a NULL LineIndex");
+    index->source = source;
+    index->size = 0;
+    // Rough guess of ~64 bytes per line, like the pose parser
+    if (LineIndex_Reserve(index, source.length / 64 + 16) != EXIT_OK) {
+        return EXIT_ERR;
+    }
+    StringView rest = source;
+    size_t base = 0;
+    while (rest.length > 0) {
+        if (index->size == index->capacity &&
+            LineIndex_Reserve(index, index->capacity * 2) != EXIT_OK) {
+            return EXIT_ERR;
+        }
+        Span* spans = &index->items[index->size];
+        size_t consumed = 0;
+        size_t n_spans = StringView_ScanSpans(
+            rest, delim, spans, index->capacity - index->size, &consumed
+        );
+        // Rebase onto `source` and drop empty pieces, as String_Split does
+        for (size_t i = 0; i < n_spans; ++i) {
+            if (spans[i].length == 0) continue;
+            index->items[index->size++] =
+                (Span){base + spans[i].offset, spans[i].length};
+        }
+        base += consumed;
+        rest.start += consumed;
+        rest.length -= consumed;
+    }
+    return EXIT_OK;
+}
+
+StringView LineIndex_Get(const LineIndex* index, size_t i) {
+    assert(i < index->size && "LineIndex access out of bounds");
+    return (StringView){
+        .start = &index->source.start[index->items[i].offset],
+        .length = index->items[i].length,
+    };
+}
+
+void LineIndex_Reset(LineIndex* index) {
+    if (index == NULL) {
         return;
     }
-    str->size = 0;
-    memset(str->items, 0, str->capacity);
+    index->size = 0;
     return;
 }
 
-bool String_IsEmpty(String* str) {
-    return str->items == NULL || str->size == 0;
+bool LineIndex_IsEmpty(LineIndex* index) {
+    return index->items == NULL || index->size == 0;
 }
 
-void String_Free(String* str) {
-    if (str == NULL || str->items == NULL) {
+void LineIndex_Free(LineIndex* index) {
+    if (index == NULL || index->items == NULL) {
         return;
     }
-    free(str->items);
-    str->items = NULL;
-    str->capacity = 0;
-    str->size = 0;
+    free(index->items);
+    AllocTrace_Release(index->capacity * sizeof(Span));
+    index->items = NULL;
+    index->capacity = 0;
+    index->size = 0;
     return;
 }
 
-String* VecString_Alloc(VecString* vec) {
+String* (VecString_Alloc)(VecString* vec) {
     assert(vec != 0 && "Cannot allocate from NULL VecString");
     // Handle uninitialized
     if (vec->capacity <= 0) {
@@ -123,6 +281,7 @@ String* VecString_Alloc(VecString* vec) {
             fprintf(stderr, "Out of memory\n");
             return NULL;
         }
+        AllocTrace_Record("VecString", vec->capacity * sizeof(String), 0);
     }
     if (vec->capacity <= vec->size + 1) {
         vec->capacity *= 2;
@@ -132,11 +291,14 @@ String* VecString_Alloc(VecString* vec) {
             fprintf(stderr, "Out of memory\n");
             return NULL;
         }
+        AllocTrace_Record(
+            "VecString",
+            vec->capacity * sizeof(String),
+            vec->capacity / 2 * sizeof(String)
+        );
     }
     String* new_str = &vec->items[vec->size];
-    new_str->items = NULL;
-    new_str->capacity = 0;
-    new_str->size = 0;
+    memset(new_str, 0, sizeof(*new_str));
     vec->size += 1;
     return new_str;
 }
@@ -164,43 +326,1186 @@ void VecString_Free(VecString* vec) {
         String_Free(&vec->items[i]);
     }
     free(vec->items);
+    AllocTrace_Release(vec->capacity * sizeof(String));
     vec->items = NULL;
     vec->capacity = 0;
     vec->size = 0;
     return;
 }
 
+static inline u32 Bits_CountTrailingZeros(u32 bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (u32)__builtin_ctz(bits);
+#else
+    u32 count = 0;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        count += 1;
+    }
+    return count;
+#endif
+}
+
+/* Bit i set where block[i] is either delimiter, for one SIMD block */
+#if defined(TYPES_SIMD_AVX2)
+#define SCAN_BLOCK 32
+static inline u32 Scan_BlockMask(
+    const char* block, __m256i delims_a, __m256i delims_b
+) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)block);
+    __m256i matches = _mm256_or_si256(
+        _mm256_cmpeq_epi8(bytes, delims_a), _mm256_cmpeq_epi8(bytes, delims_b)
+    );
+    return (u32)_mm256_movemask_epi8(matches);
+}
+#elif defined(TYPES_SIMD_SSE2)
+#define SCAN_BLOCK 16
+static inline u32 Scan_BlockMask(
+    const char* block, __m128i delims_a, __m128i delims_b
+) {
+    __m128i bytes = _mm_loadu_si128((const __m128i*)block);
+    __m128i matches = _mm_or_si128(
+        _mm_cmpeq_epi8(bytes, delims_a), _mm_cmpeq_epi8(bytes, delims_b)
+    );
+    return (u32)_mm_movemask_epi8(matches);
+}
+#endif
+
+/* Shared by ScanSpans and ScanFields; pass the same delimiter twice for one */
+static size_t Scan_Spans(
+    StringView view,
+    const char delim_a,
+    const char delim_b,
+    Span* spans,
+    size_t max_spans,
+    size_t* consumed
+) {
+    const char* buf = view.start;
+    size_t len = view.length;
+    size_t n_spans = 0;
+    size_t piece_start = 0;
+    size_t i = 0;
+#if defined(TYPES_SIMD_AVX2) || defined(TYPES_SIMD_SSE2)
+#if defined(TYPES_SIMD_AVX2)
+    __m256i delims_a = _mm256_set1_epi8(delim_a);
+    __m256i delims_b = _mm256_set1_epi8(delim_b);
+#else
+    __m128i delims_a = _mm_set1_epi8(delim_a);
+    __m128i delims_b = _mm_set1_epi8(delim_b);
+#endif
+    for (; i + SCAN_BLOCK <= len; i += SCAN_BLOCK) {
+        u32 mask = Scan_BlockMask(&buf[i], delims_a, delims_b);
+        while (mask != 0) {
+            size_t pos = i + Bits_CountTrailingZeros(mask);
+            if (n_spans == max_spans) {
+                *consumed = piece_start;
+                return n_spans;
+            }
+            spans[n_spans++] = (Span){piece_start, pos - piece_start};
+            piece_start = pos + 1;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        if (buf[i] != delim_a && buf[i] != delim_b) continue;
+        if (n_spans == max_spans) {
+            *consumed = piece_start;
+            return n_spans;
+        }
+        spans[n_spans++] = (Span){piece_start, i - piece_start};
+        piece_start = i + 1;
+    }
+    if (piece_start < len) {
+        if (n_spans == max_spans) {
+            *consumed = piece_start;
+            return n_spans;
+        }
+        spans[n_spans++] = (Span){piece_start, len - piece_start};
+    }
+    *consumed = len;
+    return n_spans;
+}
+
+/*
+ * Record the pieces of `view` separated by `delim` as (offset, length)
+ * spans without copying anything.  Empty pieces between adjacent
+ * delimiters are kept; a trailing delimiter does not produce one.  Stops
+ * once `max_spans` are written; `consumed` is how far the caller should
+ * advance `view` before scanning again.
+ */
+size_t StringView_ScanSpans(
+    StringView view,
+    const char delim,
+    Span* spans,
+    size_t max_spans,
+    size_t* consumed
+) {
+    return Scan_Spans(view, delim, delim, spans, max_spans, consumed);
+}
+
+/*
+ * Like StringView_ScanSpans, but pieces end at either `field_delim` or
+ * `line_delim`, so a CSV buffer is split into fields in a single pass.
+ * The byte just past a span tells which delimiter ended it; a span that
+ * reaches the end of `view` ended the input.
+ */
+size_t StringView_ScanFields(
+    StringView view,
+    const char field_delim,
+    const char line_delim,
+    Span* spans,
+    size_t max_spans,
+    size_t* consumed
+) {
+    return Scan_Spans(
+        view, field_delim, line_delim, spans, max_spans, consumed
+    );
+}
+
+StringView StringView_NextToken(StringView* rest, const char delim) {
+    StringView token = {.start = rest->start, .length = rest->length};
+    char* found = memchr(rest->start, delim, rest->length);
+    if (found == NULL) {
+        rest->start += rest->length;
+        rest->length = 0;
+        return token;
+    }
+    token.length = (size_t)(found - rest->start);
+    rest->start = found + 1;
+    rest->length -= token.length + 1;
+    return token;
+}
+
+StringView StringView_Trim(StringView view) {
+    while (view.length > 0 &&
+           (view.start[0] == ' ' || view.start[0] == '\t')) {
+        view.start += 1;
+        view.length -= 1;
+    }
+    while (view.length > 0) {
+        char c = view.start[view.length - 1];
+        if (c != ' ' && c != '\t' && c != '\r') break;
+        view.length -= 1;
+    }
+    return view;
+}
+
+EXIT_STATUS StringView_ParseU32(StringView view, u32* value) {
+    if (view.length == 0) {
+        return EXIT_ERR;
+    }
+    u64 parsed = 0;
+    for (size_t i = 0; i < view.length; ++i) {
+        u32 digit = (u32)(view.start[i] - '0');
+        if (digit > 9) {
+            return EXIT_ERR;
+        }
+        parsed = parsed * 10 + digit;
+        if (parsed > UINT32_MAX) {
+            return EXIT_ERR;
+        }
+    }
+    *value = (u32)parsed;
+    return EXIT_OK;
+}
+
+/*
+ * Truncated 128-bit approximations of 5^q for the decimal exponents a
+ * binary32 can reach with a 19 digit mantissa, normalized so the top bit is
+ * set.  Same construction as the fast_float tables.
+ */
+#define POW5_MIN_EXP -65
+#define POW5_MAX_EXP 38
+static const u64 POW5_128[][2] = {
+    {0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL}, /* 5^-65 */
+    {0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL}, /* 5^-64 */
+    {0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL}, /* 5^-63 */
+    {0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL}, /* 5^-62 */
+    {0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL}, /* 5^-61 */
+    {0xcdb02555653131b6ULL, 0x3792f412cb06794dULL}, /* 5^-60 */
+    {0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL}, /* 5^-59 */
+    {0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL}, /* 5^-58 */
+    {0xc8de047564d20a8bULL, 0xf245825a5a445275ULL}, /* 5^-57 */
+    {0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL}, /* 5^-56 */
+    {0x9ced737bb6c4183dULL, 0x55464dd69685606bULL}, /* 5^-55 */
+    {0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL}, /* 5^-54 */
+    {0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL}, /* 5^-53 */
+    {0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL}, /* 5^-52 */
+    {0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL}, /* 5^-51 */
+    {0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL}, /* 5^-50 */
+    {0x95a8637627989aadULL, 0xdde7001379a44aa8ULL}, /* 5^-49 */
+    {0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL}, /* 5^-48 */
+    {0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL}, /* 5^-47 */
+    {0x9226712162ab070dULL, 0xcab3961304ca70e8ULL}, /* 5^-46 */
+    {0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL}, /* 5^-45 */
+    {0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL}, /* 5^-44 */
+    {0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL}, /* 5^-43 */
+    {0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL}, /* 5^-42 */
+    {0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL}, /* 5^-41 */
+    {0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL}, /* 5^-40 */
+    {0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL}, /* 5^-39 */
+    {0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL}, /* 5^-38 */
+    {0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL}, /* 5^-37 */
+    {0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL}, /* 5^-36 */
+    {0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL}, /* 5^-35 */
+    {0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL}, /* 5^-34 */
+    {0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL}, /* 5^-33 */
+    {0xcfb11ead453994baULL, 0x67de18eda5814af2ULL}, /* 5^-32 */
+    {0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL}, /* 5^-31 */
+    {0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL}, /* 5^-30 */
+    {0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL}, /* 5^-29 */
+    {0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL}, /* 5^-28 */
+    {0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL}, /* 5^-27 */
+    {0xc612062576589ddaULL, 0x95364afe032a819eULL}, /* 5^-26 */
+    {0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL}, /* 5^-25 */
+    {0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL}, /* 5^-24 */
+    {0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL}, /* 5^-23 */
+    {0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL}, /* 5^-22 */
+    {0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL}, /* 5^-21 */
+    {0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL}, /* 5^-20 */
+    {0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL}, /* 5^-19 */
+    {0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL}, /* 5^-18 */
+    {0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL}, /* 5^-17 */
+    {0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL}, /* 5^-16 */
+    {0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL}, /* 5^-15 */
+    {0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL}, /* 5^-14 */
+    {0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL}, /* 5^-13 */
+    {0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL}, /* 5^-12 */
+    {0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL}, /* 5^-11 */
+    {0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL}, /* 5^-10 */
+    {0x89705f4136b4a597ULL, 0x31680a88f8953031ULL}, /* 5^-9 */
+    {0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL}, /* 5^-8 */
+    {0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL}, /* 5^-7 */
+    {0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL}, /* 5^-6 */
+    {0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL}, /* 5^-5 */
+    {0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL}, /* 5^-4 */
+    {0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL}, /* 5^-3 */
+    {0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL}, /* 5^-2 */
+    {0xccccccccccccccccULL, 0xcccccccccccccccdULL}, /* 5^-1 */
+    {0x8000000000000000ULL, 0x0000000000000000ULL}, /* 5^0 */
+    {0xa000000000000000ULL, 0x0000000000000000ULL}, /* 5^1 */
+    {0xc800000000000000ULL, 0x0000000000000000ULL}, /* 5^2 */
+    {0xfa00000000000000ULL, 0x0000000000000000ULL}, /* 5^3 */
+    {0x9c40000000000000ULL, 0x0000000000000000ULL}, /* 5^4 */
+    {0xc350000000000000ULL, 0x0000000000000000ULL}, /* 5^5 */
+    {0xf424000000000000ULL, 0x0000000000000000ULL}, /* 5^6 */
+    {0x9896800000000000ULL, 0x0000000000000000ULL}, /* 5^7 */
+    {0xbebc200000000000ULL, 0x0000000000000000ULL}, /* 5^8 */
+    {0xee6b280000000000ULL, 0x0000000000000000ULL}, /* 5^9 */
+    {0x9502f90000000000ULL, 0x0000000000000000ULL}, /* 5^10 */
+    {0xba43b74000000000ULL, 0x0000000000000000ULL}, /* 5^11 */
+    {0xe8d4a51000000000ULL, 0x0000000000000000ULL}, /* 5^12 */
+    {0x9184e72a00000000ULL, 0x0000000000000000ULL}, /* 5^13 */
+    {0xb5e620f480000000ULL, 0x0000000000000000ULL}, /* 5^14 */
+    {0xe35fa931a0000000ULL, 0x0000000000000000ULL}, /* 5^15 */
+    {0x8e1bc9bf04000000ULL, 0x0000000000000000ULL}, /* 5^16 */
+    {0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL}, /* 5^17 */
+    {0xde0b6b3a76400000ULL, 0x0000000000000000ULL}, /* 5^18 */
+    {0x8ac7230489e80000ULL, 0x0000000000000000ULL}, /* 5^19 */
+    {0xad78ebc5ac620000ULL, 0x0000000000000000ULL}, /* 5^20 */
+    {0xd8d726b7177a8000ULL, 0x0000000000000000ULL}, /* 5^21 */
+    {0x878678326eac9000ULL, 0x0000000000000000ULL}, /* 5^22 */
+    {0xa968163f0a57b400ULL, 0x0000000000000000ULL}, /* 5^23 */
+    {0xd3c21bcecceda100ULL, 0x0000000000000000ULL}, /* 5^24 */
+    {0x84595161401484a0ULL, 0x0000000000000000ULL}, /* 5^25 */
+    {0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL}, /* 5^26 */
+    {0xcecb8f27f4200f3aULL, 0x0000000000000000ULL}, /* 5^27 */
+    {0x813f3978f8940984ULL, 0x4000000000000000ULL}, /* 5^28 */
+    {0xa18f07d736b90be5ULL, 0x5000000000000000ULL}, /* 5^29 */
+    {0xc9f2c9cd04674edeULL, 0xa400000000000000ULL}, /* 5^30 */
+    {0xfc6f7c4045812296ULL, 0x4d00000000000000ULL}, /* 5^31 */
+    {0x9dc5ada82b70b59dULL, 0xf020000000000000ULL}, /* 5^32 */
+    {0xc5371912364ce305ULL, 0x6c28000000000000ULL}, /* 5^33 */
+    {0xf684df56c3e01bc6ULL, 0xc732000000000000ULL}, /* 5^34 */
+    {0x9a130b963a6c115cULL, 0x3c7f400000000000ULL}, /* 5^35 */
+    {0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL}, /* 5^36 */
+    {0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL}, /* 5^37 */
+    {0x96769950b50d88f4ULL, 0x1314448000000000ULL}, /* 5^38 */
+};
+
+static inline u32 Bits_CountLeadingZeros64(u64 bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (u32)__builtin_clzll(bits);
+#else
+    u32 count = 0;
+    while ((bits & 0x8000000000000000ULL) == 0) {
+        bits <<= 1;
+        count += 1;
+    }
+    return count;
+#endif
+}
+
+static inline void U64_MulFull(u64 a, u64 b, u64* high, u64* low) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 u128;
+    u128 product = (u128)a * b;
+    *high = (u64)(product >> 64);
+    *low = (u64)product;
+#else
+    u64 a_lo = a & 0xFFFFFFFF;
+    u64 a_hi = a >> 32;
+    u64 b_lo = b & 0xFFFFFFFF;
+    u64 b_hi = b >> 32;
+    u64 p0 = a_lo * b_lo;
+    u64 p1 = a_lo * b_hi;
+    u64 p2 = a_hi * b_lo;
+    u64 p3 = a_hi * b_hi;
+    u64 mid = (p0 >> 32) + (p1 & 0xFFFFFFFF) + (p2 & 0xFFFFFFFF);
+    *low = (mid << 32) | (p0 & 0xFFFFFFFF);
+    *high = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+#endif
+}
+
+/*
+ * Eisel-Lemire: the binary32 nearest to w * 10^q as raw exponent and
+ * mantissa bits (no sign), for any non-zero w.  The 128-bit product is
+ * always precise enough for binary32 (Mushtak & Lemire, "Fast number
+ * parsing without fallback").
+ */
+static u32 F32_BitsFromDecimal(u64 w, i64 q) {
+    const int mantissa_bits = 23;
+    if (w == 0 || q < POW5_MIN_EXP) {
+        return 0;
+    }
+    if (q > POW5_MAX_EXP) {
+        return 0xFFu << mantissa_bits;
+    }
+    u32 lz = Bits_CountLeadingZeros64(w);
+    w <<= lz;
+
+    const u64* pow5 = POW5_128[q - POW5_MIN_EXP];
+    u64 high;
+    u64 low;
+    U64_MulFull(w, pow5[0], &high, &low);
+    const u64 precision_mask = 0xFFFFFFFFFFFFFFFFULL >> (mantissa_bits + 3);
+    if ((high & precision_mask) == precision_mask) {
+        u64 second_high;
+        u64 second_low;
+        U64_MulFull(w, pow5[1], &second_high, &second_low);
+        low += second_high;
+        if (second_high > low) {
+            high += 1;
+        }
+    }
+
+    int upper_bit = (int)(high >> 63);
+    int shift = upper_bit + 64 - mantissa_bits - 3;
+    u64 mantissa = high >> shift;
+    // floor(q * log2(10)) + 63, offset by the binary32 exponent bias
+    i32 power2 = (i32)(((152170 + 65536) * q) >> 16) + 63 + upper_bit -
+                 (i32)lz + 127;
+
+    if (power2 <= 0) {
+        // Subnormal
+        if (-power2 + 1 >= 64) {
+            return 0;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (1ULL << mantissa_bits) ? 0 : 1;
+        return ((u32)power2 << mantissa_bits) |
+               (u32)(mantissa & ((1ULL << mantissa_bits) - 1));
+    }
+    // Exactly halfway between two floats: round to even, not up
+    if (low <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1 &&
+        (mantissa << shift) == high) {
+        mantissa &= ~1ULL;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << mantissa_bits)) {
+        mantissa = 1ULL << mantissa_bits;
+        power2 += 1;
+    }
+    mantissa &= ~(1ULL << mantissa_bits);
+    if (power2 >= 0xFF) {
+        return 0xFFu << mantissa_bits;
+    }
+    return ((u32)power2 << mantissa_bits) | (u32)mantissa;
+}
+
+// Longest field copied to the stack for the strtof fallback
+#define FIELD_MAX_LEN 127
+
+/* Rare inputs (inf, nan, hex floats, ambiguous > 19 digit mantissas) */
+static EXIT_STATUS F32_ParseFallback(StringView view, f32* value) {
+    if (view.length == 0 || view.length > FIELD_MAX_LEN) {
+        return EXIT_ERR;
+    }
+    char field[FIELD_MAX_LEN + 1];
+    memcpy(field, view.start, view.length);
+    field[view.length] = '\0';
+    char* end = NULL;
+    *value = strtof(field, &end);
+    if (end != &field[view.length]) {
+        return EXIT_ERR;
+    }
+    return EXIT_OK;
+}
+
 /*
-EXIT_STATUS get_poses(std::string* content, std::vector<Pose>* poses) {
-    std::vector<std::string> lines;
-    get_lines(content, &lines);
-    if (lines.size() == 0) {
-        fprintf(stderr, "Got 0 lines\n");
-        return EXIT_ERR;
-    }
-    printf("Got %ld lines\n", lines.size());
-    for (size_t i = 0; i < lines.size(); ++i) {
-        std::vector<std::string> values;
-        get_values(&lines[i], &values);
-        if (values.size() != 8) {
-            fprintf(stderr, "Expected 8 values.  Got %ld.\n", values.size());
+ * Correctly rounded decimal to binary32 without copying or NUL terminating
+ * the field, independent of the current locale.  Up to 19 significant
+ * digits go into an integer mantissa.  Small exact cases take the Clinger
+ * fast path, everything else Eisel-Lemire.
+ */
+EXIT_STATUS StringView_ParseF32(StringView view, f32* value) {
+    static const f32 exact_pow10[] = {
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+    };
+    const char* ptr = view.start;
+    const char* end = view.start + view.length;
+    bool negative = false;
+    if (ptr < end && (*ptr == '-' || *ptr == '+')) {
+        negative = *ptr == '-';
+        ptr += 1;
+    }
+
+    u64 mantissa = 0;
+    i64 exponent = 0;
+    u32 n_digits = 0;
+    bool any_digits = false;
+    bool truncated = false;
+    for (; ptr < end && (u32)(*ptr - '0') <= 9; ++ptr) {
+        u32 digit = (u32)(*ptr - '0');
+        any_digits = true;
+        if (n_digits < 19) {
+            mantissa = mantissa * 10 + digit;
+            n_digits += mantissa != 0;
+        } else {
+            truncated |= digit != 0;
+            exponent += 1;
+        }
+    }
+    if (ptr < end && *ptr == '.') {
+        ptr += 1;
+        for (; ptr < end && (u32)(*ptr - '0') <= 9; ++ptr) {
+            u32 digit = (u32)(*ptr - '0');
+            any_digits = true;
+            if (n_digits < 19) {
+                mantissa = mantissa * 10 + digit;
+                n_digits += mantissa != 0;
+                exponent -= 1;
+            } else {
+                truncated |= digit != 0;
+            }
+        }
+    }
+    if (!any_digits) {
+        return F32_ParseFallback(view, value);
+    }
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+        ptr += 1;
+        bool exp_negative = false;
+        if (ptr < end && (*ptr == '-' || *ptr == '+')) {
+            exp_negative = *ptr == '-';
+            ptr += 1;
+        }
+        if (ptr == end || (u32)(*ptr - '0') > 9) {
             return EXIT_ERR;
         }
-        Pose pose = {.id = (size_t)atoi(values[0].c_str()),
-                     .replicate_id = (size_t)atoi(values[1].c_str()),
-                     .rvec =
-                         {
-                             .x = (float)atof(values[2].c_str()),
-                             .y = (float)atof(values[3].c_str()),
-                             .z = (float)atof(values[4].c_str()),
-                         },
-                     .tvec = {
-                         .x = (float)atof(values[5].c_str()),
-                         .y = (float)atof(values[6].c_str()),
-                         .z = (float)atof(values[7].c_str()),
-                     }};
-        poses->push_back(pose);
+        i64 exp_value = 0;
+        for (; ptr < end && (u32)(*ptr - '0') <= 9; ++ptr) {
+            // Saturate; anything this large is already 0 or inf
+            if (exp_value < 100000) {
+                exp_value = exp_value * 10 + (*ptr - '0');
+            }
+        }
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+    if (ptr != end) {
+        return F32_ParseFallback(view, value);
+    }
+
+    f32 result;
+    if (!truncated && mantissa <= (1u << 24) && exponent >= -10 &&
+        exponent <= 10) {
+        // Both operands are exact, so one rounding gives the right answer
+        result = (f32)mantissa;
+        result = exponent < 0 ? result / exact_pow10[-exponent]
+                              : result * exact_pow10[exponent];
+    } else {
+        u32 bits = F32_BitsFromDecimal(mantissa, exponent);
+        // Dropped digits put the value between w and w + 1; only trust
+        // the result if both ends round the same way.
+        if (truncated && bits != F32_BitsFromDecimal(mantissa + 1, exponent)) {
+            return F32_ParseFallback(view, value);
+        }
+        memcpy(&result, &bits, sizeof(result));
+    }
+    *value = negative ? -result : result;
+    return EXIT_OK;
+}
+
+EXIT_STATUS (VecPose_Reserve)(VecPose* vec, size_t capacity) {
+    assert(vec != NULL && "Cannot reserve a NULL VecPose");
+    if (vec->capacity >= capacity) {
+        return EXIT_OK;
+    }
+    size_t bytes = capacity * sizeof(Pose);
+    Pose* items =
+        vec->arena != NULL
+            ? (Pose*)(VirtualStack_Grow)(
+                  vec->arena, vec->items, bytes, DEFAULT_ALIGNMENT
+              )
+            : (Pose*)realloc(vec->items, bytes);
+    if (items == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_ERR;
+    }
+    if (vec->arena == NULL) {
+        AllocTrace_Record("VecPose", bytes, vec->capacity * sizeof(Pose));
     }
+    vec->items = items;
+    vec->capacity = capacity;
     return EXIT_OK;
 }
-*/
+
+Pose* (VecPose_Alloc)(VecPose* vec) {
+    assert(vec != NULL && "Cannot allocate from NULL VecPose");
+    if (vec->capacity <= vec->size) {
+        size_t capacity = vec->capacity < 64 ? 64 : vec->capacity * 2;
+        if ((VecPose_Reserve)(vec, capacity) != EXIT_OK) {
+            return NULL;
+        }
+    }
+    Pose* pose = &vec->items[vec->size];
+    vec->size += 1;
+    return pose;
+}
+
+void VecPose_Reset(VecPose* vec) {
+    if (vec == NULL) {
+        return;
+    }
+    vec->size = 0;
+    return;
+}
+
+bool VecPose_IsEmpty(VecPose* vec) {
+    return vec->items == NULL || vec->size == 0;
+}
+
+void VecPose_Free(VecPose* vec) {
+    if (vec == NULL || vec->items == NULL) {
+        return;
+    }
+    if (vec->arena == NULL) {
+        free(vec->items);
+        AllocTrace_Release(vec->capacity * sizeof(Pose));
+    }
+    vec->items = NULL;
+    vec->capacity = 0;
+    vec->size = 0;
+    return;
+}
+
+#define POSE_CSV_COLUMNS 8
+
+/* Parse the trimmed fields of one CSV line; nothing is copied */
+static EXIT_STATUS Pose_ParseFields(const StringView* fields, Pose* pose) {
+    f32 values[POSE_CSV_COLUMNS - 2];
+    if (StringView_ParseU32(fields[0], &pose->id) != EXIT_OK ||
+        StringView_ParseU32(fields[1], &pose->replicate_id) != EXIT_OK) {
+        return EXIT_ERR;
+    }
+    for (size_t i = 0; i < POSE_CSV_COLUMNS - 2; ++i) {
+        if (StringView_ParseF32(fields[i + 2], &values[i]) != EXIT_OK) {
+            return EXIT_ERR;
+        }
+    }
+    pose->rvec = (Vec3){values[0], values[1], values[2]};
+    pose->tvec = (Vec3){values[3], values[4], values[5]};
+    return EXIT_OK;
+}
+
+/*
+ * Append the line made of `n_fields` fields (only the first
+ * POSE_CSV_COLUMNS are stored) to `poses`.  Blank lines are skipped, and
+ * so is the first non-blank line while `first_line` is set, if its first
+ * field is not a number: that is the header row.  A first line that starts
+ * with a number is data and must parse like any other.
+ */
+static EXIT_STATUS Poses_AddLine(
+    VecPose* poses,
+    const StringView* fields,
+    size_t n_fields,
+    bool* first_line
+) {
+    // We don't care about empty lines
+    if (n_fields == 1 && fields[0].length == 0) {
+        return EXIT_OK;
+    }
+    f32 number;
+    bool header = *first_line &&
+                  StringView_ParseF32(fields[0], &number) != EXIT_OK;
+    *first_line = false;
+    if (n_fields == POSE_CSV_COLUMNS) {
+        Pose* pose = VecPose_Alloc(poses);
+        if (pose == NULL) {
+            return EXIT_ERR;
+        }
+        if (Pose_ParseFields(fields, pose) == EXIT_OK) {
+            return EXIT_OK;
+        }
+        poses->size -= 1;
+    }
+    return header ? EXIT_OK : EXIT_ERR;
+}
+
+/*
+ * Parse every line of `chunk` into `poses`.  Only the first chunk of a file
+ * may start with a header row.  On failure `error_offset` is the offset of
+ * the offending line within `chunk`.
+ */
+static EXIT_STATUS Poses_ParseChunk(
+    StringView chunk, VecPose* poses, bool allow_header, size_t* error_offset
+) {
+    // Rough guess of ~64 bytes per line keeps reallocation to a minimum
+    if (VecPose_Reserve(poses, poses->size + chunk.length / 64 + 1) !=
+        EXIT_OK) {
+        *error_offset = 0;
+        return EXIT_ERR;
+    }
+    // Fields and line ends come out of one scan; a line may straddle two
+    // batches of spans, so its fields are kept as views into `chunk`.
+    StringView rest = chunk;
+    Span pieces[256];
+    StringView fields[POSE_CSV_COLUMNS];
+    size_t n_fields = 0;
+    const char* line_start = chunk.start;
+    bool first_line = allow_header;
+    while (rest.length > 0) {
+        size_t consumed = 0;
+        size_t n_pieces = StringView_ScanFields(
+            rest, ',', '\n', pieces, sizeof(pieces) / sizeof(pieces[0]),
+            &consumed
+        );
+        for (size_t i = 0; i < n_pieces; ++i) {
+            size_t end = pieces[i].offset + pieces[i].length;
+            if (n_fields < POSE_CSV_COLUMNS) {
+                fields[n_fields] = StringView_Trim((StringView){
+                    .start = &rest.start[pieces[i].offset],
+                    .length = pieces[i].length,
+                });
+            }
+            n_fields += 1;
+            if (end < rest.length && rest.start[end] == ',') {
+                continue;
+            }
+            if (Poses_AddLine(poses, fields, n_fields, &first_line) !=
+                EXIT_OK) {
+                *error_offset = (size_t)(line_start - chunk.start);
+                return EXIT_ERR;
+            }
+            n_fields = 0;
+            line_start = &rest.start[end + 1];
+        }
+        rest.start += consumed;
+        rest.length -= consumed;
+    }
+    // A comma right before the end of input leaves one empty field open
+    if (n_fields > 0) {
+        if (n_fields < POSE_CSV_COLUMNS) {
+            fields[n_fields] = (StringView){0};
+        }
+        n_fields += 1;
+        if (Poses_AddLine(poses, fields, n_fields, &first_line) != EXIT_OK) {
+            *error_offset = (size_t)(line_start - chunk.start);
+            return EXIT_ERR;
+        }
+    }
+    return EXIT_OK;
+}
+
+static void Poses_ReportError(StringView content, size_t error_offset) {
+    size_t line_number = 1;
+    for (size_t i = 0; i < error_offset; ++i) {
+        line_number += content.start[i] == '\n';
+    }
+    StringView rest = {
+        .start = &content.start[error_offset],
+        .length = content.length - error_offset,
+    };
+    StringView line = StringView_Trim(StringView_NextToken(&rest, '\n'));
+    fprintf(
+        stderr,
+        "Failed to parse pose on line %zu: %.*s\n",
+        line_number,
+        (int)line.length,
+        line.start
+    );
+}
+
+EXIT_STATUS Poses_ParseCSV(StringView content, VecPose* poses) {
+    assert(poses != NULL && "Cannot parse into a NULL VecPose");
+    size_t error_offset = 0;
+    if (Poses_ParseChunk(content, poses, true, &error_offset) != EXIT_OK) {
+        Poses_ReportError(content, error_offset);
+        return EXIT_ERR;
+    }
+    return EXIT_OK;
+}
+
+// Chunks smaller than this are not worth a thread
+#define PARSE_MIN_CHUNK (1 << 20)
+
+typedef struct ParseTask {
+    StringView chunk;
+    bool allow_header;
+    VecPose poses;
+    VirtualStack arena;
+    size_t error_offset;
+    EXIT_STATUS status;
+} ParseTask;
+
+static void* Poses_ParseTask(void* arg) {
+    ParseTask* task = (ParseTask*)arg;
+    // Thread-local results grow in place instead of being realloc'd; fall
+    // back to the heap if the address space cannot be reserved.
+    if (VirtualStack_Init(&task->arena, VIRTUAL_STACK_DEFAULT_RESERVE)) {
+        task->poses.arena = &task->arena;
+    }
+    task->status = Poses_ParseChunk(
+        task->chunk, &task->poses, task->allow_header, &task->error_offset
+    );
+    return NULL;
+}
+
+EXIT_STATUS Poses_ParseCSVParallel(
+    StringView content, VecPose* poses, size_t n_threads
+) {
+    assert(poses != NULL && "Cannot parse into a NULL VecPose");
+    if (n_threads == 0) {
+        long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = n_cpus > 0 ? (size_t)n_cpus : 1;
+        size_t max_chunks = content.length / PARSE_MIN_CHUNK + 1;
+        if (n_threads > max_chunks) {
+            n_threads = max_chunks;
+        }
+    }
+    if (n_threads <= 1) {
+        return Poses_ParseCSV(content, poses);
+    }
+
+    // Bookkeeping only lives for this call
+    Scratch scratch = Scratch_Begin(NULL, 0);
+    ParseTask* tasks = ArenaAlloc(scratch.arena, ParseTask, n_threads);
+    pthread_t* threads = ArenaAlloc(scratch.arena, pthread_t, n_threads);
+    bool* started = ArenaAlloc(scratch.arena, bool, n_threads);
+    if (tasks == NULL || threads == NULL || started == NULL) {
+        Scratch_End(scratch);
+        return EXIT_ERR;
+    }
+
+    // Cut at evenly spaced offsets, each pushed forward past the next newline
+    size_t chunk_start = 0;
+    for (size_t i = 0; i < n_threads; ++i) {
+        size_t chunk_end = content.length;
+        if (i + 1 < n_threads) {
+            chunk_end = content.length / n_threads * (i + 1);
+            if (chunk_end < chunk_start) chunk_end = chunk_start;
+            char* newline = memchr(
+                &content.start[chunk_end], '\n', content.length - chunk_end
+            );
+            chunk_end = newline == NULL
+                            ? content.length
+                            : (size_t)(newline - content.start) + 1;
+        }
+        tasks[i].chunk = (StringView){
+            .start = &content.start[chunk_start],
+            .length = chunk_end - chunk_start,
+        };
+        tasks[i].allow_header = i == 0;
+        tasks[i].status = EXIT_OK;
+        chunk_start = chunk_end;
+    }
+
+    // Chunk 0 runs on the calling thread
+    for (size_t i = 1; i < n_threads; ++i) {
+        started[i] =
+            pthread_create(&threads[i], NULL, Poses_ParseTask, &tasks[i]) == 0;
+        if (!started[i]) {
+            Poses_ParseTask(&tasks[i]);
+        }
+    }
+    Poses_ParseTask(&tasks[0]);
+
+    EXIT_STATUS status = EXIT_OK;
+    size_t total = poses->size;
+    for (size_t i = 0; i < n_threads; ++i) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        total += tasks[i].poses.size;
+    }
+    for (size_t i = 0; i < n_threads && status == EXIT_OK; ++i) {
+        if (tasks[i].status != EXIT_OK) {
+            size_t chunk_offset = (size_t)(tasks[i].chunk.start - content.start);
+            Poses_ReportError(content, chunk_offset + tasks[i].error_offset);
+            status = EXIT_ERR;
+        }
+    }
+
+    // Merge the thread-local buffers in file order
+    if (status == EXIT_OK && VecPose_Reserve(poses, total) == EXIT_OK) {
+        for (size_t i = 0; i < n_threads; ++i) {
+            if (tasks[i].poses.size == 0) continue;
+            memcpy(
+                &poses->items[poses->size],
+                tasks[i].poses.items,
+                tasks[i].poses.size * sizeof(Pose)
+            );
+            poses->size += tasks[i].poses.size;
+        }
+    } else {
+        status = EXIT_ERR;
+    }
+
+    for (size_t i = 0; i < n_threads; ++i) {
+        VecPose_Free(&tasks[i].poses);
+        VirtualStack_Release(&tasks[i].arena);
+    }
+    Scratch_End(scratch);
+    return status;
+}
+
+EXIT_STATUS Poses_LoadCSV(
+    const char* filepath, VecPose* poses, size_t n_threads
+) {
+    FileView file = {0};
+    if (FileView_Open(&file, filepath) != EXIT_OK) {
+        return EXIT_ERR;
+    }
+    EXIT_STATUS status =
+        Poses_ParseCSVParallel(file.content, poses, n_threads);
+    FileView_Close(&file);
+    return status;
+}
+
+#define POSE_CACHE_PATH_MAX 4096
+
+static size_t PoseCache_Stride(size_t count) {
+    return (count + 15) & ~(size_t)15;
+}
+
+static size_t PoseCache_FileSize(size_t stride) {
+    return sizeof(PoseCacheHeader) +
+           POSE_CACHE_COLUMNS * stride * sizeof(u32);
+}
+
+/* Fletcher-style sum over 32-bit words; order sensitive and cheap */
+static void PoseCache_Checksum(const u32* words, size_t n, u64* sum, u64* acc) {
+    u64 a = *sum;
+    u64 b = *acc;
+    for (size_t i = 0; i < n; ++i) {
+        a += words[i];
+        b += a;
+    }
+    *sum = a;
+    *acc = b;
+}
+
+/* Column `column` of poses[first, first + n) as raw 32-bit words */
+static void PoseCache_FillColumn(
+    u32* dst, const Pose* poses, size_t first, size_t n, size_t column
+) {
+    for (size_t i = 0; i < n; ++i) {
+        const Pose* pose = &poses[first + i];
+        f32 value;
+        switch (column) {
+            case 0: dst[i] = pose->id; continue;
+            case 1: dst[i] = pose->replicate_id; continue;
+            case 2: value = pose->rvec.x; break;
+            case 3: value = pose->rvec.y; break;
+            case 4: value = pose->rvec.z; break;
+            case 5: value = pose->tvec.x; break;
+            case 6: value = pose->tvec.y; break;
+            default: value = pose->tvec.z; break;
+        }
+        memcpy(&dst[i], &value, sizeof(value));
+    }
+}
+
+static EXIT_STATUS write_full(int fd, const void* buffer, size_t size) {
+    const char* bytes = (const char*)buffer;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return EXIT_ERR;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return EXIT_OK;
+}
+
+/*
+ * Streams each column through a small buffer, so the SoA image is never
+ * held in memory.  Writes to a temporary file and renames it into place so
+ * a concurrent reader never sees a partial cache.
+ */
+EXIT_STATUS PoseCache_Write(
+    const char* filepath,
+    const Pose* poses,
+    size_t count,
+    const PoseCacheSource* source
+) {
+    char tmp_path[POSE_CACHE_PATH_MAX];
+    int written =
+        snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", filepath, (long)getpid());
+    if (written < 0 || (size_t)written >= sizeof(tmp_path)) {
+        fprintf(stderr, "Pose cache path too long: %s\n", filepath);
+        return EXIT_ERR;
+    }
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("open");
+        return EXIT_ERR;
+    }
+
+    size_t stride = PoseCache_Stride(count);
+    PoseCacheHeader header = {
+        .magic = POSE_CACHE_MAGIC,
+        .version = POSE_CACHE_VERSION,
+        .count = count,
+        .stride = stride,
+        .data_offset = sizeof(PoseCacheHeader),
+    };
+    if (source != NULL) {
+        header.source = *source;
+    }
+    u32 block[4096];
+    u64 sum = 0;
+    u64 acc = 0;
+    EXIT_STATUS status = write_full(fd, &header, sizeof(header));
+    for (size_t column = 0; column < POSE_CACHE_COLUMNS; ++column) {
+        for (size_t first = 0; first < stride && status == EXIT_OK;
+             first += 4096) {
+            size_t n = stride - first < 4096 ? stride - first : 4096;
+            size_t n_valid = first >= count ? 0
+                             : count - first < n ? count - first
+                                                 : n;
+            PoseCache_FillColumn(block, poses, first, n_valid, column);
+            memset(&block[n_valid], 0, (n - n_valid) * sizeof(u32));
+            PoseCache_Checksum(block, n, &sum, &acc);
+            status = write_full(fd, block, n * sizeof(u32));
+        }
+    }
+    header.checksum = sum ^ (acc << 32 | acc >> 32);
+    if (status == EXIT_OK &&
+        pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        status = EXIT_ERR;
+    }
+    if (status != EXIT_OK) {
+        perror("write");
+    }
+    if (close(fd) != 0) {
+        perror("close");
+        status = EXIT_ERR;
+    }
+    if (status == EXIT_OK && rename(tmp_path, filepath) != 0) {
+        perror("rename");
+        status = EXIT_ERR;
+    }
+    if (status != EXIT_OK) {
+        unlink(tmp_path);
+    }
+    return status;
+}
+
+/* Point `cache->poses` at the columns of a validated cache image */
+static void PoseCache_BindColumns(PoseCache* cache) {
+    const PoseCacheHeader* header = (const PoseCacheHeader*)cache->data;
+    size_t stride = (size_t)header->stride;
+    u32* columns = (u32*)((u8*)cache->data + header->data_offset);
+    f32* floats = (f32*)columns;
+    size_t count = (size_t)header->count;
+    cache->poses = (PoseSoA){
+        .id = &columns[0 * stride],
+        .replicate_id = &columns[1 * stride],
+        .rvec = {&floats[2 * stride], &floats[3 * stride], &floats[4 * stride],
+                 count, stride},
+        .tvec = {&floats[5 * stride], &floats[6 * stride], &floats[7 * stride],
+                 count, stride},
+        .size = count,
+    };
+}
+
+EXIT_STATUS PoseCache_Open(PoseCache* cache, const char* filepath) {
+    memset(cache, 0, sizeof(*cache));
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return EXIT_ERR;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        (size_t)info.st_size < sizeof(PoseCacheHeader)) {
+        close(fd);
+        return EXIT_ERR;
+    }
+    size_t file_size = (size_t)info.st_size;
+    void* map = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_ERR;
+    }
+
+    // Bound count and stride by the file before doing arithmetic on them,
+    // so a hostile header cannot wrap the stride or size computations
+    const PoseCacheHeader* header = (const PoseCacheHeader*)map;
+    u64 row_bytes = POSE_CACHE_COLUMNS * sizeof(u32);
+    u64 max_rows = (file_size - sizeof(PoseCacheHeader)) / row_bytes;
+    if (header->magic != POSE_CACHE_MAGIC ||
+        header->version != POSE_CACHE_VERSION ||
+        header->data_offset != sizeof(PoseCacheHeader) ||
+        header->count > max_rows || header->stride > max_rows ||
+        header->stride != PoseCache_Stride((size_t)header->count) ||
+        PoseCache_FileSize((size_t)header->stride) != file_size) {
+        munmap(map, file_size);
+        return EXIT_ERR;
+    }
+    cache->data = map;
+    cache->data_size = file_size;
+    cache->mapped = true;
+    PoseCache_BindColumns(cache);
+    return EXIT_OK;
+}
+
+/*
+ * Full checksum pass; touches every page, so it is not done on open.
+ * PoseCache_Load only runs it when asked to.
+ */
+EXIT_STATUS PoseCache_Verify(const PoseCache* cache) {
+    const PoseCacheHeader* header = (const PoseCacheHeader*)cache->data;
+    u64 sum = 0;
+    u64 acc = 0;
+    PoseCache_Checksum(
+        (const u32*)((const u8*)cache->data + header->data_offset),
+        POSE_CACHE_COLUMNS * (size_t)header->stride,
+        &sum,
+        &acc
+    );
+    if ((sum ^ (acc << 32 | acc >> 32)) != header->checksum) {
+        fprintf(stderr, "Pose cache checksum mismatch\n");
+        return EXIT_ERR;
+    }
+    return EXIT_OK;
+}
+
+void PoseCache_Close(PoseCache* cache) {
+    if (cache == NULL || cache->data == NULL) {
+        return;
+    }
+    if (cache->mapped) {
+        munmap(cache->data, cache->data_size);
+    } else {
+        free(cache->data);
+    }
+    memset(cache, 0, sizeof(*cache));
+}
+
+/* Heap copy of the cache image, for when the cache file cannot be written */
+static EXIT_STATUS PoseCache_FromPoses(
+    PoseCache* cache, const Pose* poses, size_t count
+) {
+    size_t stride = PoseCache_Stride(count);
+    size_t size = PoseCache_FileSize(stride);
+    void* data = NULL;
+    if (posix_memalign(&data, SOA_ALIGNMENT, size) != 0) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_ERR;
+    }
+    memset(data, 0, size);
+    PoseCacheHeader* header = (PoseCacheHeader*)data;
+    *header = (PoseCacheHeader){
+        .magic = POSE_CACHE_MAGIC,
+        .version = POSE_CACHE_VERSION,
+        .count = count,
+        .stride = stride,
+        .data_offset = sizeof(PoseCacheHeader),
+    };
+    u32* columns = (u32*)((u8*)data + header->data_offset);
+    for (size_t column = 0; column < POSE_CACHE_COLUMNS; ++column) {
+        PoseCache_FillColumn(&columns[column * stride], poses, 0, count, column);
+    }
+    u64 sum = 0;
+    u64 acc = 0;
+    PoseCache_Checksum(columns, POSE_CACHE_COLUMNS * stride, &sum, &acc);
+    header->checksum = sum ^ (acc << 32 | acc >> 32);
+    cache->data = data;
+    cache->data_size = size;
+    cache->mapped = false;
+    PoseCache_BindColumns(cache);
+    return EXIT_OK;
+}
+
+static bool PoseCache_SameSource(
+    const PoseCacheSource* a, const PoseCacheSource* b
+) {
+    return a->size == b->size && a->mtime_sec == b->mtime_sec &&
+           a->mtime_nsec == b->mtime_nsec;
+}
+
+EXIT_STATUS PoseCache_Load(
+    PoseCache* cache, const char* csv_path, size_t n_threads, bool verify
+) {
+    char cache_path[POSE_CACHE_PATH_MAX];
+    int written =
+        snprintf(cache_path, sizeof(cache_path), "%s.posecache", csv_path);
+    if (written < 0 || (size_t)written >= sizeof(cache_path)) {
+        fprintf(stderr, "Pose cache path too long: %s\n", csv_path);
+        return EXIT_ERR;
+    }
+
+    // Identity of the CSV as it is now; recorded in a rebuilt cache, so an
+    // edit during the parse only costs another rebuild next time
+    struct stat csv_info;
+    struct stat cache_info;
+    bool have_csv = stat(csv_path, &csv_info) == 0;
+    bool have_cache = stat(cache_path, &cache_info) == 0;
+    PoseCacheSource source = {0};
+    if (have_csv) {
+        source = (PoseCacheSource){
+            .size = (u64)csv_info.st_size,
+            .mtime_sec = (i64)csv_info.st_mtim.tv_sec,
+            .mtime_nsec = (i64)csv_info.st_mtim.tv_nsec,
+        };
+    }
+    if (have_cache) {
+        // Opening only reads the header; the columns are paged in as used
+        if (PoseCache_Open(cache, cache_path) != EXIT_OK) {
+            fprintf(stderr, "Ignoring invalid pose cache %s\n", cache_path);
+        } else {
+            const PoseCacheHeader* header = (const PoseCacheHeader*)cache->data;
+            if (have_csv && !PoseCache_SameSource(&header->source, &source)) {
+                fprintf(stderr, "Rebuilding stale pose cache %s\n", cache_path);
+            } else if (!verify || PoseCache_Verify(cache) == EXIT_OK) {
+                return EXIT_OK;
+            }
+            PoseCache_Close(cache);
+        }
+    }
+
+    VecPose poses = {0};
+    if (Poses_LoadCSV(csv_path, &poses, n_threads) != EXIT_OK) {
+        VecPose_Free(&poses);
+        return EXIT_ERR;
+    }
+    EXIT_STATUS status = EXIT_ERR;
+    if (PoseCache_Write(cache_path, poses.items, poses.size, &source) ==
+        EXIT_OK) {
+        status = PoseCache_Open(cache, cache_path);
+    }
+    if (status != EXIT_OK) {
+        // Read-only directory or similar: keep the image on the heap
+        status = PoseCache_FromPoses(cache, poses.items, poses.size);
+    }
+    VecPose_Free(&poses);
+    return status;
+}
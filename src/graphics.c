@@ -1,13 +1,194 @@
+#include <math.h>
+
 #include "graphics.h"
+#include "csv.h"
+
+#define DEMO_POSE_GRID 16
+// --animate restreams this many poses per frame, round robin, so large
+// sets animate at a steady upload cost
+#define ANIMATE_POSES_PER_FRAME 65536
+
+typedef struct {
+    const PoseSoA* base;
+    PoseSoA poses;  // Animated copy of `base`, streamed to the GPU
+    Stack arena;
+    size_t next;
+} DemoAnimation;
+
+// A grid of poses in front of the origin, each turned a little further
+// about its own axis, for when no CSV is given
+static bool make_demo_poses(PoseSoA* poses, Stack* arena) {
+    size_t n = DEMO_POSE_GRID;
+    if (PoseSoA_Init(poses, arena, n * n * n) != SUCCESS) {
+        return false;
+    }
+    for (size_t i = 0; i < n * n * n; ++i) {
+        f32 x = (f32)(i % n) - 0.5f * (f32)(n - 1);
+        f32 y = (f32)(i / n % n) - 0.5f * (f32)(n - 1);
+        f32 z = (f32)(i / (n * n));
+        Pose pose = {
+            .id = (u32)i,
+            .replicate_id = 0,
+            .rvec = {0.05f * x, 0.05f * y, 0.02f * (f32)i / (f32)n},
+            .tvec = {x, y, 2.0f * (f32)n + z},
+        };
+        PoseSoA_Set(poses, i, pose);
+    }
+    return true;
+}
+
+static bool animation_init(DemoAnimation* animation, const PoseSoA* base) {
+    size_t padded = SoA_PaddedCount(base->size);
+    size_t size = 8 * (padded * sizeof(f32) + SOA_ALIGNMENT);
+    void* memory = calloc(1, size);
+    if (!memory) {
+        return false;
+    }
+    Stack_Init(&animation->arena, memory, size);
+    if (PoseSoA_Init(&animation->poses, &animation->arena, base->size) !=
+        SUCCESS) {
+        return false;
+    }
+    size_t n = base->size;
+    memcpy(animation->poses.id, base->id, n * sizeof(u32));
+    memcpy(animation->poses.replicate_id, base->replicate_id, n * sizeof(u32));
+    memcpy(animation->poses.rvec.x, base->rvec.x, n * sizeof(f32));
+    memcpy(animation->poses.rvec.y, base->rvec.y, n * sizeof(f32));
+    memcpy(animation->poses.rvec.z, base->rvec.z, n * sizeof(f32));
+    memcpy(animation->poses.tvec.x, base->tvec.x, n * sizeof(f32));
+    memcpy(animation->poses.tvec.y, base->tvec.y, n * sizeof(f32));
+    memcpy(animation->poses.tvec.z, base->tvec.z, n * sizeof(f32));
+    animation->base = base;
+    animation->next = 0;
+    return true;
+}
+
+// Frame callback: rocks the next window of poses about their z axis and
+// streams them through graphics_engine_update_poses
+static void animate_poses(
+    GraphicsEngine* engine, double seconds, void* userdata
+) {
+    DemoAnimation* animation = userdata;
+    const PoseSoA* base = animation->base;
+    size_t first = animation->next;
+    size_t count = base->size - first;
+    if (count > ANIMATE_POSES_PER_FRAME) {
+        count = ANIMATE_POSES_PER_FRAME;
+    }
+    for (size_t i = first; i < first + count; ++i) {
+        f32 phase = (f32)seconds + 0.05f * (f32)i;
+        animation->poses.rvec.z[i] = base->rvec.z[i] + 0.5f * sinf(phase);
+    }
+    graphics_engine_update_poses(engine, &animation->poses, first, count);
+    animation->next = first + count < base->size ? first + count : 0;
+}
+
+static void usage(const char* program) {
+    fprintf(
+        stderr,
+        "Usage: %s [--headless <capture.ppm>] "
+        "[--present fifo|fifo-relaxed|mailbox|immediate] [--fps <max>] "
+        "[--frames-in-flight <1-%d>] [--continuous] [--animate] "
+        "[--verify-cache] [poses.csv]\n",
+        program,
+        MAX_FRAMES_IN_FLIGHT_LIMIT
+    );
+}
 
-// Main function
 int main(int argc, char* argv[]) {
-    GraphicsEngine* engine = graphics_engine_create("Graphics Engine", 800, 600);
+    const char* capture_path = NULL;
+    const char* csv_path = NULL;
+    bool animate = false;
+    bool verify_cache = false;
+    GraphicsOptions options = graphics_default_options();
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--headless") == 0 && has_value) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--present") == 0 && has_value) {
+            if (!graphics_present_mode_from_name(
+                    argv[++i], &options.present_mode
+                )) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fps") == 0 && has_value) {
+            options.max_fps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--frames-in-flight") == 0 && has_value) {
+            options.max_frames_in_flight = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--continuous") == 0) {
+            options.continuous = true;
+        } else if (strcmp(argv[i], "--verify-cache") == 0) {
+            // Checksum the whole pose cache instead of trusting its header
+            verify_cache = true;
+        } else if (strcmp(argv[i], "--animate") == 0) {
+            // Every frame changes, so there is no point waiting for events
+            animate = true;
+            options.continuous = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            csv_path = argv[i];
+        }
+    }
+
+    GraphicsEngine* engine =
+        capture_path
+            ? graphics_engine_create_headless(800, 600)
+            : graphics_engine_create("Graphics Engine", 800, 600, &options);
     if (!engine) {
         return 1;
     }
 
-    graphics_engine_run(engine);
+    PoseCache cache = {0};
+    Stack demo_arena = {0};
+    PoseSoA demo_poses = {0};
+    const PoseSoA* poses = &demo_poses;
+    if (csv_path) {
+        if (PoseCache_Load(&cache, csv_path, 0, verify_cache) != EXIT_OK) {
+            graphics_engine_destroy(engine);
+            return 1;
+        }
+        poses = &cache.poses;
+    } else {
+        size_t size = 64 * DEMO_POSE_GRID * DEMO_POSE_GRID * DEMO_POSE_GRID;
+        void* memory = malloc(size);
+        if (memory) {
+            Stack_Init(&demo_arena, memory, size);
+        }
+        if (!memory || !make_demo_poses(&demo_poses, &demo_arena)) {
+            free(memory);
+            graphics_engine_destroy(engine);
+            return 1;
+        }
+    }
+
+    int status = 0;
+    DemoAnimation animation = {0};
+    if (!graphics_engine_set_poses(engine, poses)) {
+        status = 1;
+    } else if (animate && !animation_init(&animation, poses)) {
+        status = 1;
+    } else if (capture_path) {
+        if (animate) {
+            // One step, so the capture shows streamed rather than initial
+            // instances
+            animate_poses(engine, 1.0, &animation);
+        }
+        status = graphics_engine_capture(engine, capture_path) ? 0 : 1;
+    } else {
+        if (animate) {
+            graphics_engine_set_frame_callback(
+                engine, animate_poses, &animation
+            );
+        }
+        graphics_engine_run(engine);
+    }
+
     graphics_engine_destroy(engine);
-    return 0;
+    PoseCache_Close(&cache);
+    free(demo_arena.buffer);
+    free(animation.arena.buffer);
+    return status;
 }
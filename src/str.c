@@ -0,0 +1,545 @@
+#include "str.h"
+
+#include <assert.h>
+
+RETURN_STATUS (String_Reserve)(String* str, size_t capacity) {
+    if (capacity <= STRING_INLINE_CAPACITY || capacity <= str->capacity) {
+        return SUCCESS;
+    }
+    // Amortised doubling; the first heap buffer skips the tiny sizes
+    size_t new_capacity = str->capacity * 2;
+    if (new_capacity < STRING_MIN_HEAP_CAPACITY) {
+        new_capacity = STRING_MIN_HEAP_CAPACITY;
+    }
+    if (new_capacity < capacity) {
+        new_capacity = capacity;
+    }
+    char* heap;
+    if (String_IsInline(str)) {
+        heap = (char*)malloc(new_capacity);
+        if (heap != NULL) {
+            memcpy(heap, str->data.inline_items, str->size);
+        }
+    } else {
+        heap = (char*)realloc(str->data.heap, new_capacity);
+    }
+    if (heap == NULL) {
+        fprintf(stderr, "ERROR: failed to reallocate String");
+        return FAILURE;
+    }
+    AllocTrace_Record(
+        "String", new_capacity, String_IsInline(str) ? 0 : str->capacity
+    );
+    str->data.heap = heap;
+    str->capacity = new_capacity;
+    return SUCCESS;
+}
+
+RETURN_STATUS (String_Append)(String* str, const char* data, size_t len) {
+    if ((String_Reserve)(str, str->size + len) != SUCCESS) {
+        return FAILURE;
+    }
+    memcpy(&String_Data(str)[str->size], data, len);
+    str->size += len;
+    return SUCCESS;
+}
+
+RETURN_STATUS (String_AppendStr)(String* str, const char* input_str) {
+    return (String_Append)(str, input_str, strlen(input_str));
+}
+
+RETURN_STATUS (String_AppendChar)(String* str, char c) {
+    return (String_Append)(str, &c, 1);
+}
+
+RETURN_STATUS (String_AppendMany)(String* str, ...) {
+    va_list args;
+    va_start(args, str);
+    RETURN_STATUS status = SUCCESS;
+    const char* append_str;
+    while (status == SUCCESS &&
+           (append_str = va_arg(args, const char*)) != NULL) {
+        status = (String_AppendStr)(str, append_str);
+    }
+    va_end(args);
+    return status;
+}
+
+/* Writes `value` right-aligned so it ends just before `end` */
+static char* U32_FormatBackwards(u32 value, char* end) {
+    do {
+        *--end = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return end;
+}
+
+RETURN_STATUS (String_AppendU64)(String* str, u64 value) {
+    char buffer[20];
+    char* end = &buffer[sizeof(buffer)];
+    char* start = end;
+    do {
+        *--start = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return (String_Append)(str, start, (size_t)(end - start));
+}
+
+/*
+ * Ryu (Adams, "Ryu: fast float-to-string conversion", PLDI 2018) for
+ * binary32.  F32_POW5_INV[q] is 2^(F32_POW5_INV_BITS + bits(5^q) - 1) / 5^q
+ * rounded up, F32_POW5[i] is 5^i scaled to F32_POW5_BITS bits.
+ */
+#define F32_POW5_INV_BITS 59
+#define F32_POW5_BITS 61
+static const u64 F32_POW5_INV[31] = {
+    0x0800000000000001ULL, /* 5^-0 */
+    0x0666666666666667ULL, /* 5^-1 */
+    0x051eb851eb851eb9ULL, /* 5^-2 */
+    0x04189374bc6a7efaULL, /* 5^-3 */
+    0x068db8bac710cb2aULL, /* 5^-4 */
+    0x053e2d6238da3c22ULL, /* 5^-5 */
+    0x0431bde82d7b634eULL, /* 5^-6 */
+    0x06b5fca6af2bd216ULL, /* 5^-7 */
+    0x055e63b88c230e78ULL, /* 5^-8 */
+    0x044b82fa09b5a52dULL, /* 5^-9 */
+    0x06df37f675ef6eaeULL, /* 5^-10 */
+    0x057f5ff85e592558ULL, /* 5^-11 */
+    0x0465e6604b7a8447ULL, /* 5^-12 */
+    0x0709709a125da071ULL, /* 5^-13 */
+    0x05a126e1a84ae6c1ULL, /* 5^-14 */
+    0x0480ebe7b9d58567ULL, /* 5^-15 */
+    0x0734aca5f6226f0bULL, /* 5^-16 */
+    0x05c3bd5191b525a3ULL, /* 5^-17 */
+    0x049c97747490eae9ULL, /* 5^-18 */
+    0x0760f253edb4ab0eULL, /* 5^-19 */
+    0x05e72843249088d8ULL, /* 5^-20 */
+    0x04b8ed0283a6d3e0ULL, /* 5^-21 */
+    0x078e480405d7b966ULL, /* 5^-22 */
+    0x060b6cd004ac9452ULL, /* 5^-23 */
+    0x04d5f0a66a23a9dbULL, /* 5^-24 */
+    0x07bcb43d769f762bULL, /* 5^-25 */
+    0x063090312bb2c4efULL, /* 5^-26 */
+    0x04f3a68dbc8f03f3ULL, /* 5^-27 */
+    0x07ec3daf94180651ULL, /* 5^-28 */
+    0x065697bfa9acd1daULL, /* 5^-29 */
+    0x051212ffbaf0a7e2ULL, /* 5^-30 */
+};
+static const u64 F32_POW5[47] = {
+    0x1000000000000000ULL, /* 5^0 */
+    0x1400000000000000ULL, /* 5^1 */
+    0x1900000000000000ULL, /* 5^2 */
+    0x1f40000000000000ULL, /* 5^3 */
+    0x1388000000000000ULL, /* 5^4 */
+    0x186a000000000000ULL, /* 5^5 */
+    0x1e84800000000000ULL, /* 5^6 */
+    0x1312d00000000000ULL, /* 5^7 */
+    0x17d7840000000000ULL, /* 5^8 */
+    0x1dcd650000000000ULL, /* 5^9 */
+    0x12a05f2000000000ULL, /* 5^10 */
+    0x174876e800000000ULL, /* 5^11 */
+    0x1d1a94a200000000ULL, /* 5^12 */
+    0x12309ce540000000ULL, /* 5^13 */
+    0x16bcc41e90000000ULL, /* 5^14 */
+    0x1c6bf52634000000ULL, /* 5^15 */
+    0x11c37937e0800000ULL, /* 5^16 */
+    0x16345785d8a00000ULL, /* 5^17 */
+    0x1bc16d674ec80000ULL, /* 5^18 */
+    0x1158e460913d0000ULL, /* 5^19 */
+    0x15af1d78b58c4000ULL, /* 5^20 */
+    0x1b1ae4d6e2ef5000ULL, /* 5^21 */
+    0x10f0cf064dd59200ULL, /* 5^22 */
+    0x152d02c7e14af680ULL, /* 5^23 */
+    0x1a784379d99db420ULL, /* 5^24 */
+    0x108b2a2c28029094ULL, /* 5^25 */
+    0x14adf4b7320334b9ULL, /* 5^26 */
+    0x19d971e4fe8401e7ULL, /* 5^27 */
+    0x1027e72f1f128130ULL, /* 5^28 */
+    0x1431e0fae6d7217cULL, /* 5^29 */
+    0x193e5939a08ce9dbULL, /* 5^30 */
+    0x1f8def8808b02452ULL, /* 5^31 */
+    0x13b8b5b5056e16b3ULL, /* 5^32 */
+    0x18a6e32246c99c60ULL, /* 5^33 */
+    0x1ed09bead87c0378ULL, /* 5^34 */
+    0x13426172c74d822bULL, /* 5^35 */
+    0x1812f9cf7920e2b6ULL, /* 5^36 */
+    0x1e17b84357691b64ULL, /* 5^37 */
+    0x12ced32a16a1b11eULL, /* 5^38 */
+    0x178287f49c4a1d66ULL, /* 5^39 */
+    0x1d6329f1c35ca4bfULL, /* 5^40 */
+    0x125dfa371a19e6f7ULL, /* 5^41 */
+    0x16f578c4e0a060b5ULL, /* 5^42 */
+    0x1cb2d6f618c878e3ULL, /* 5^43 */
+    0x11efc659cf7d4b8dULL, /* 5^44 */
+    0x166bb7f0435c9e71ULL, /* 5^45 */
+    0x1c06a5ec5433c60dULL, /* 5^46 */
+};
+
+/* ceil(log2(5^e)) for e >= 1, and 1 for e == 0 */
+static inline i32 F32_Pow5Bits(i32 e) {
+    return (i32)(((u32)e * 1217359u) >> 19) + 1;
+}
+
+/* floor(log10(2^e)) */
+static inline u32 F32_Log10Pow2(i32 e) {
+    return ((u32)e * 78913u) >> 18;
+}
+
+/* floor(log10(5^e)) */
+static inline u32 F32_Log10Pow5(i32 e) {
+    return ((u32)e * 732923u) >> 20;
+}
+
+static inline bool F32_MultipleOfPow5(u32 value, u32 p) {
+    u32 count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count += 1;
+    }
+    return count >= p;
+}
+
+static inline bool F32_MultipleOfPow2(u32 value, u32 p) {
+    return (value & ((1u << p) - 1)) == 0;
+}
+
+/* (m * factor) >> shift for a 64-bit factor, shift > 32 */
+static inline u32 F32_MulShift(u32 m, u64 factor, i32 shift) {
+    u64 low = (u64)m * (u32)factor;
+    u64 high = (u64)m * (u32)(factor >> 32);
+    return (u32)(((low >> 32) + high) >> (shift - 32));
+}
+
+/*
+ * Shortest (digits, exponent) with digits * 10^exponent inside the
+ * rounding interval of the finite, non-zero float with the given fields.
+ */
+static void F32_ShortestDecimal(
+    u32 ieee_mantissa, u32 ieee_exponent, u32* digits, i32* exponent
+) {
+    const i32 mantissa_bits = 23;
+    const i32 bias = 127;
+    i32 e2;
+    u32 m2;
+    if (ieee_exponent == 0) {
+        e2 = 1 - bias - mantissa_bits - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (i32)ieee_exponent - bias - mantissa_bits - 2;
+        m2 = (1u << mantissa_bits) | ieee_mantissa;
+    }
+    const bool accept_bounds = (m2 & 1) == 0;
+
+    // Interval of values that round to this float, scaled by 4
+    const u32 mv = 4 * m2;
+    const u32 mp = 4 * m2 + 2;
+    const u32 mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+    const u32 mm = 4 * m2 - 1 - mm_shift;
+
+    u32 vr;
+    u32 vp;
+    u32 vm;
+    i32 e10;
+    bool vm_trailing_zeros = false;
+    bool vr_trailing_zeros = false;
+    u32 last_removed = 0;
+    if (e2 >= 0) {
+        const u32 q = F32_Log10Pow2(e2);
+        e10 = (i32)q;
+        const i32 k = F32_POW5_INV_BITS + F32_Pow5Bits((i32)q) - 1;
+        const i32 i = -e2 + (i32)q + k;
+        vr = F32_MulShift(mv, F32_POW5_INV[q], i);
+        vp = F32_MulShift(mp, F32_POW5_INV[q], i);
+        vm = F32_MulShift(mm, F32_POW5_INV[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            // One removed digit is needed for rounding even if the loop
+            // below does not run
+            const i32 l = F32_POW5_INV_BITS + F32_Pow5Bits((i32)q - 1) - 1;
+            last_removed =
+                F32_MulShift(mv, F32_POW5_INV[q - 1], -e2 + (i32)q - 1 + l) %
+                10;
+        }
+        if (q <= 9) {
+            // At most one of mp, mv and mm can be a multiple of 5
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = F32_MultipleOfPow5(mv, q);
+            } else if (accept_bounds) {
+                vm_trailing_zeros = F32_MultipleOfPow5(mm, q);
+            } else {
+                vp -= F32_MultipleOfPow5(mp, q);
+            }
+        }
+    } else {
+        const u32 q = F32_Log10Pow5(-e2);
+        e10 = (i32)q + e2;
+        const i32 i = -e2 - (i32)q;
+        const i32 k = F32_Pow5Bits(i) - F32_POW5_BITS;
+        i32 j = (i32)q - k;
+        vr = F32_MulShift(mv, F32_POW5[i], j);
+        vp = F32_MulShift(mp, F32_POW5[i], j);
+        vm = F32_MulShift(mm, F32_POW5[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = (i32)q - 1 - (F32_Pow5Bits(i + 1) - F32_POW5_BITS);
+            last_removed = F32_MulShift(mv, F32_POW5[i + 1], j) % 10;
+        }
+        if (q <= 1) {
+            // mv = 4 * m2 always has at least two trailing zero bits
+            vr_trailing_zeros = true;
+            if (accept_bounds) {
+                vm_trailing_zeros = mm_shift == 1;
+            } else {
+                vp -= 1;
+            }
+        } else if (q < 31) {
+            vr_trailing_zeros = F32_MultipleOfPow2(mv, q - 1);
+        }
+    }
+
+    // Drop digits while the interval still holds a shorter number
+    i32 removed = 0;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed += 1;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed += 1;
+            }
+        }
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+            // Exactly halfway: round to even
+            last_removed = 4;
+        }
+        *digits = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) ||
+                        last_removed >= 5);
+    } else {
+        while (vp / 10 > vm / 10) {
+            last_removed = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed += 1;
+        }
+        *digits = vr + (vr == vm || last_removed >= 5);
+    }
+    *exponent = e10 + removed;
+}
+
+static u32 U32_DecimalLength(u32 value) {
+    u32 length = 1;
+    while (value >= 10) {
+        value /= 10;
+        length += 1;
+    }
+    return length;
+}
+
+size_t F32_Format(f32 value, char* out) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    u32 ieee_mantissa = bits & 0x7FFFFFu;
+    u32 ieee_exponent = (bits >> 23) & 0xFFu;
+    char* cursor = out;
+    if (ieee_exponent == 0xFF && ieee_mantissa != 0) {
+        memcpy(cursor, "nan", 3);
+        return 3;
+    }
+    if (bits >> 31) {
+        *cursor++ = '-';
+    }
+    if (ieee_exponent == 0xFF) {
+        memcpy(cursor, "inf", 3);
+        return (size_t)(cursor - out) + 3;
+    }
+    if (ieee_exponent == 0 && ieee_mantissa == 0) {
+        *cursor++ = '0';
+        return (size_t)(cursor - out);
+    }
+
+    u32 digits;
+    i32 exponent;
+    F32_ShortestDecimal(ieee_mantissa, ieee_exponent, &digits, &exponent);
+    i32 length = (i32)U32_DecimalLength(digits);
+    // Position of the decimal point relative to the first digit
+    i32 point = length + exponent;
+
+    if (point > 0 && point <= 9) {
+        if (exponent >= 0) {
+            // Integer: digits then zeros
+            U32_FormatBackwards(digits, cursor + length);
+            cursor += length;
+            memset(cursor, '0', (size_t)exponent);
+            cursor += exponent;
+        } else {
+            // Point inside the digits
+            U32_FormatBackwards(digits, cursor + length + 1);
+            memmove(cursor, cursor + 1, (size_t)point);
+            cursor[point] = '.';
+            cursor += length + 1;
+        }
+    } else if (point <= 0 && point > -5) {
+        *cursor++ = '0';
+        *cursor++ = '.';
+        memset(cursor, '0', (size_t)-point);
+        cursor += -point;
+        U32_FormatBackwards(digits, cursor + length);
+        cursor += length;
+    } else {
+        // d[.ddd]e[-]x
+        U32_FormatBackwards(digits, cursor + length + 1);
+        cursor[0] = cursor[1];
+        if (length > 1) {
+            cursor[1] = '.';
+            cursor += length + 1;
+        } else {
+            cursor += 1;
+        }
+        *cursor++ = 'e';
+        i32 scientific = point - 1;
+        if (scientific < 0) {
+            *cursor++ = '-';
+            scientific = -scientific;
+        }
+        u32 exp_length = U32_DecimalLength((u32)scientific);
+        U32_FormatBackwards((u32)scientific, cursor + exp_length);
+        cursor += exp_length;
+    }
+    return (size_t)(cursor - out);
+}
+
+RETURN_STATUS (String_AppendF32)(String* str, f32 value) {
+    if ((String_Reserve)(str, str->size + F32_FORMAT_MAX) != SUCCESS) {
+        return FAILURE;
+    }
+    str->size += F32_Format(value, &String_Data(str)[str->size]);
+    return SUCCESS;
+}
+
+/* Writes "[a, b, ...]" straight into the buffer, reserved once up front */
+static RETURN_STATUS String_AppendF32List(
+    String* str, const f32* values, size_t n
+) {
+    size_t max_length = 2 + n * (F32_FORMAT_MAX + 2);
+    if ((String_Reserve)(str, str->size + max_length) != SUCCESS) {
+        return FAILURE;
+    }
+    char* cursor = &String_Data(str)[str->size];
+    char* start = cursor;
+    *cursor++ = '[';
+    for (size_t i = 0; i < n; ++i) {
+        if (i != 0) {
+            *cursor++ = ',';
+            *cursor++ = ' ';
+        }
+        cursor += F32_Format(values[i], cursor);
+    }
+    *cursor++ = ']';
+    str->size += (size_t)(cursor - start);
+    return SUCCESS;
+}
+
+RETURN_STATUS (String_AppendVec3)(String* str, Vec3 vec) {
+    f32 values[3] = {vec.x, vec.y, vec.z};
+    return String_AppendF32List(str, values, 3);
+}
+
+RETURN_STATUS (String_AppendVec4)(String* str, Vec4 vec) {
+    f32 values[4] = {vec.x, vec.y, vec.z, vec.w};
+    return String_AppendF32List(str, values, 4);
+}
+
+RETURN_STATUS (String_AppendMat4)(String* str, Mat4 mat) {
+    if ((String_AppendStr)(str, "[\n\t") != SUCCESS) {
+        return FAILURE;
+    }
+    Vec4* row_ptr = (Vec4*)&mat;
+    size_t n_rows = 4;
+    for (size_t i = 0; i < n_rows; ++i) {
+        if ((String_AppendVec4)(str, row_ptr[i]) != SUCCESS) {
+            return FAILURE;
+        }
+        if ((String_AppendStr)(str, i != n_rows - 1 ? "\n\t" : "\n") !=
+            SUCCESS) {
+            return FAILURE;
+        }
+    }
+    if ((String_AppendStr)(str, "]\n") != SUCCESS) {
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+RETURN_STATUS (String_AppendPose)(String* str, Pose pose) {
+    // Two u32s, six floats, separators and the newline
+    size_t max_length = 2 * 10 + 6 * F32_FORMAT_MAX + 8;
+    if ((String_Reserve)(str, str->size + max_length) != SUCCESS) {
+        return FAILURE;
+    }
+    char* start = &String_Data(str)[str->size];
+    char* cursor = start;
+    u32 ids[2] = {pose.id, pose.replicate_id};
+    for (size_t i = 0; i < 2; ++i) {
+        u32 length = U32_DecimalLength(ids[i]);
+        U32_FormatBackwards(ids[i], cursor + length);
+        cursor += length;
+        *cursor++ = ',';
+    }
+    f32 values[6] = {
+        pose.rvec.x, pose.rvec.y, pose.rvec.z,
+        pose.tvec.x, pose.tvec.y, pose.tvec.z,
+    };
+    for (size_t i = 0; i < 6; ++i) {
+        cursor += F32_Format(values[i], cursor);
+        *cursor++ = i != 5 ? ',' : '\n';
+    }
+    str->size += (size_t)(cursor - start);
+    return SUCCESS;
+}
+
+char* (String_Detach)(String* str) {
+    char* items;
+    if (String_IsInline(str)) {
+        items = (char*)malloc(str->size > 0 ? str->size : 1);
+        if (items == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return NULL;
+        }
+        memcpy(items, str->data.inline_items, str->size);
+        AllocTrace_Record("String", str->size, 0);
+    } else {
+        items = str->data.heap;
+    }
+    memset(str, 0, sizeof(*str));
+    return items;
+}
+
+void String_Reset(String* str) {
+    if (str == NULL) {
+        return;
+    }
+    str->size = 0;
+}
+
+bool String_IsEmpty(const String* str) { return str->size == 0; }
+
+void String_Free(String* str) {
+    if (str == NULL) {
+        return;
+    }
+    if (!String_IsInline(str)) {
+        free(str->data.heap);
+        AllocTrace_Release(str->capacity);
+    }
+    memset(str, 0, sizeof(*str));
+}
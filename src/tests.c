@@ -1,21 +1,89 @@
 #include "tests.h"
 
 int main(int argc, char** argv) {
-    String output_str = {
-        .begin = malloc(sizeof(char) * 8),
-        .size = 0,
-        .capacity = 8,
-    };
-
     Test_Vec4IsEqual();
     fprintf(stdout, "Passed: Test_Vec4Equal\n");
 
+    Test_Vec4DotNormalize();
+    fprintf(stdout, "Passed: Test_Vec4DotNormalize\n");
+
     Test_Mat4IsEqual();
     fprintf(stdout, "Passed: Test_Mat4Equal\n");
 
     Test_Mat4Transpose();
     fprintf(stdout, "Passed: Test_Mat4Transpose\n");
 
+    Test_Mat4Mul();
+    fprintf(stdout, "Passed: Test_Mat4Mul\n");
+
+    Test_Mat4Inverse();
+    fprintf(stdout, "Passed: Test_Mat4Inverse\n");
+
+    Test_Mat4MulBatch();
+    fprintf(stdout, "Passed: Test_Mat4MulBatch\n");
+
+    Test_Vec3SoAKernels();
+    fprintf(stdout, "Passed: Test_Vec3SoAKernels\n");
+
+    Test_RotVec();
+    fprintf(stdout, "Passed: Test_RotVec\n");
+
+    Test_RotVecBatch();
+    fprintf(stdout, "Passed: Test_RotVecBatch\n");
+
+    Test_Quat();
+    fprintf(stdout, "Passed: Test_Quat\n");
+
+    Test_QuatResample();
+    fprintf(stdout, "Passed: Test_QuatResample\n");
+
+    Test_ArenaGrowth();
+    fprintf(stdout, "Passed: Test_ArenaGrowth\n");
+
+    Test_VirtualStack();
+    fprintf(stdout, "Passed: Test_VirtualStack\n");
+
+    Test_Pool();
+    fprintf(stdout, "Passed: Test_Pool\n");
+
+    Test_StackFlags();
+    fprintf(stdout, "Passed: Test_StackFlags\n");
+
+    Test_Scratch();
+    fprintf(stdout, "Passed: Test_Scratch\n");
+
+    Test_StringBuilder();
+    fprintf(stdout, "Passed: Test_StringBuilder\n");
+
+    Test_F32Format();
+    fprintf(stdout, "Passed: Test_F32Format\n");
+
+    Test_ScanSpans();
+    fprintf(stdout, "Passed: Test_ScanSpans\n");
+
+    Test_PosesParseCSV();
+    fprintf(stdout, "Passed: Test_PosesParseCSV\n");
+
+    Test_PosesParseParallel();
+    fprintf(stdout, "Passed: Test_PosesParseParallel\n");
+
+    Test_ParseNumbers();
+    fprintf(stdout, "Passed: Test_ParseNumbers\n");
+
+    Test_PoseRoundTrip();
+    fprintf(stdout, "Passed: Test_PoseRoundTrip\n");
+
+    Test_PoseCache();
+    fprintf(stdout, "Passed: Test_PoseCache\n");
+
+    Test_LineIndex();
+    fprintf(stdout, "Passed: Test_LineIndex\n");
+
+#ifdef ALLOC_TRACE
+    Test_AllocTrace();
+    fprintf(stdout, "Passed: Test_AllocTrace\n");
+#endif /* ALLOC_TRACE */
+
     return SUCCESS;
 }
 